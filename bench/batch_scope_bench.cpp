@@ -0,0 +1,79 @@
+//批量调度基准: 逐个schedule()和BatchScope内按批提交(每个目标线程一次入队、最多唤醒一次)的吞吐
+//从调度第一个任务到IO线程执行完最后一个任务计时
+#include <atomic>
+#include "core/scheduler.h"
+#include "bench.h"
+
+using namespace net;
+
+namespace
+{
+std::atomic<uint64_t> executed(0);
+
+class CountTask : public Task
+{
+public:
+	virtual bool run()
+	{
+		executed.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	virtual const char* name() {return "count";}
+};
+
+void waitExecuted(const uint64_t target)
+{
+	while(executed.load(std::memory_order_relaxed) < target)
+		;
+}
+
+//|batch|为0时逐个调度; |workers|个目标线程轮流
+uint64_t run(const uint64_t n, const uint32_t batch, const uint32_t workers)
+{
+	const uint64_t target = executed.load() + n;
+	uint64_t t0 = benchNowNs();
+	if(batch == 0)
+	{
+		for(uint64_t i = 0; i < n; i++)
+			BENCH_CHECK(Scheduler::instance().schedule((uint32_t)(i % workers), new CountTask()));
+	}
+	else
+	{
+		for(uint64_t i = 0; i < n; )
+		{
+			Scheduler::BatchScope scope;
+			for(uint32_t j = 0; j < batch && i < n; j++, i++)
+				BENCH_CHECK(Scheduler::instance().schedule((uint32_t)(i % workers), new CountTask()));
+		}
+	}
+	waitExecuted(target);
+	return benchNowNs() - t0;
+}
+}
+
+int main(int argc, char* argv[])
+{
+	const uint64_t n = argc > 1 ? (uint64_t)atoll(argv[1]) : 2000000;
+	const uint32_t workers = 2;
+	Scheduler::instance().start(workers);
+	//预热: IO线程启动, TaskPool缓存
+	run(100000, 0, workers);
+	run(100000, 64, workers);
+
+	const uint32_t batches[] = {0, 1, 8, 64, 512};
+	for(size_t b = 0; b < sizeof(batches) / sizeof(batches[0]); b++)
+	{
+		for(uint32_t w = 1; w <= workers; w++)
+		{
+			char label[128];
+			if(batches[b] == 0)
+				snprintf(label, sizeof(label), "per-task schedule, %u workers", w);
+			else
+				snprintf(label, sizeof(label), "BatchScope x%u, %u workers", batches[b], w);
+			benchReport(label, n, run(n, batches[b], w));
+		}
+	}
+	fflush(stdout);
+	//IO线程不退出, 直接结束进程
+	_exit(0);
+}
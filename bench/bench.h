@@ -0,0 +1,36 @@
+#ifndef __NET_BENCH_H__
+#define __NET_BENCH_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "utils/int_types.h"
+
+//基准测试公共函数: 单调时钟计时, 统一输出格式
+inline uint64_t benchNowNs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+//|ops|次操作用时|ns|纳秒
+inline void benchReport(const char* name, const uint64_t ops, const uint64_t ns)
+{
+	printf("%-44s %10llu ops %10.1f ns/op %8.2f Mops/s\n", name, (unsigned long long)ops
+		, ops ? (double)ns / ops : 0.0, ns ? ops * 1000.0 / ns : 0.0);
+	fflush(stdout);
+}
+
+//基准中的正确性检查, 失败时退出
+#define BENCH_CHECK(cond) \
+	do \
+	{ \
+		if(!(cond)) \
+		{ \
+			fprintf(stderr, "%s:%d: BENCH_CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+			exit(1); \
+		} \
+	} while(0)
+
+#endif
@@ -0,0 +1,81 @@
+//协程切换基准: 主协程和子协程来回切换, 比较汇编切换(coctx)和swapcontext
+//一次往返为两次切换; 两种实现都直接调用底层接口, 不经过Coroutine的引用计数和状态检查
+#include <ucontext.h>
+#include <vector>
+#include "core/coctx.h"
+#include "bench.h"
+
+namespace
+{
+const size_t STACK_SIZE = 64 * 1024;
+
+uint64_t rounds = 0;
+
+ucontext_t ucMain;
+ucontext_t ucChild;
+
+void ucEntry()
+{
+	for(;;)
+		swapcontext(&ucChild, &ucMain);
+}
+
+uint64_t benchUcontext()
+{
+	std::vector<char> stack(STACK_SIZE);
+	getcontext(&ucChild);
+	ucChild.uc_stack.ss_sp = &stack[0];
+	ucChild.uc_stack.ss_size = stack.size();
+	ucChild.uc_link = 0;
+	makecontext(&ucChild, ucEntry, 0);
+	swapcontext(&ucMain, &ucChild);
+
+	uint64_t t0 = benchNowNs();
+	for(uint64_t i = 0; i < rounds; i++)
+		swapcontext(&ucMain, &ucChild);
+	return benchNowNs() - t0;
+}
+
+#ifdef COROUTINE_USE_ASM
+lin_io::coctx ctxMain;
+lin_io::coctx ctxChild;
+uint64_t switches = 0;
+
+void ctxEntry(void* arg)
+{
+	for(;;)
+	{
+		switches++;
+		lin_coctx_swap(&ctxChild, &ctxMain);
+	}
+}
+
+uint64_t benchCoctx()
+{
+	std::vector<char> stack(STACK_SIZE);
+	lin_io::coctx_make(&ctxChild, &stack[0], stack.size(), ctxEntry, 0);
+	lin_coctx_swap(&ctxMain, &ctxChild);
+
+	switches = 0;
+	uint64_t t0 = benchNowNs();
+	for(uint64_t i = 0; i < rounds; i++)
+		lin_coctx_swap(&ctxMain, &ctxChild);
+	uint64_t ns = benchNowNs() - t0;
+	BENCH_CHECK(switches == rounds);
+	return ns;
+}
+#endif
+}
+
+int main(int argc, char* argv[])
+{
+	rounds = argc > 1 ? (uint64_t)atoll(argv[1]) : 10000000;
+	printf("round trips: %llu\n", (unsigned long long)rounds);
+	benchReport("swapcontext round trip", rounds, benchUcontext());
+#ifdef COROUTINE_USE_ASM
+	benchReport("coctx asm round trip", rounds, benchCoctx());
+#else
+	printf("coctx asm switch not enabled on this platform\n");
+#endif
+	return 0;
+}
@@ -0,0 +1,98 @@
+//MpscQueue基准: 1~32个生产者同时入队, 一个消费者取出, 对照组为自旋锁保护的MessageQueue
+//通知器换成计数器, 只测队列本身; 同时检查每个生产者的消息保持顺序且不丢失
+#include <vector>
+#include <thread>
+#include <atomic>
+#include "core/queue.h"
+#include "bench.h"
+
+using namespace net;
+
+namespace
+{
+std::atomic<uint64_t> notifies(0);
+
+struct CountingNotifier
+{
+	void connect(Notifier::SignalHandler*) {}
+	void disconnect(Notifier::SignalHandler*) {}
+	bool notify() {notifies.fetch_add(1, std::memory_order_relaxed); return true;}
+};
+
+struct Message : public MpscNode
+{
+	Message():producer(0),seq(0) {}
+	int producer;
+	uint64_t seq;
+};
+
+//MpscQueue和MessageQueue的消费者接口相同: pop()为空时开启下次通知
+template<typename Queue>
+void run(const char* name, const int producers, const uint64_t perProducer)
+{
+	std::vector<Message> messages(producers * perProducer);
+	for(int p = 0; p < producers; p++)
+	{
+		for(uint64_t i = 0; i < perProducer; i++)
+		{
+			Message& m = messages[p * perProducer + i];
+			m.producer = p;
+			m.seq = i;
+		}
+	}
+	Queue* queue = new Queue();
+	std::atomic<int> ready(0);
+	std::atomic<bool> go(false);
+	std::vector<std::thread> threads;
+	for(int p = 0; p < producers; p++)
+	{
+		threads.push_back(std::thread([&, p]() {
+			ready.fetch_add(1);
+			while(!go.load())
+				;
+			Message* base = &messages[p * perProducer];
+			for(uint64_t i = 0; i < perProducer; i++)
+				queue->push(base + i);
+		}));
+	}
+	while(ready.load() < producers)
+		;
+
+	std::vector<uint64_t> next(producers, 0);
+	const uint64_t total = producers * perProducer;
+	notifies.store(0);
+	uint64_t t0 = benchNowNs();
+	go.store(true);
+	for(uint64_t n = 0; n < total; )
+	{
+		Message* m = queue->pop();
+		if(!m)
+			continue;
+		BENCH_CHECK(m->seq == next[m->producer]);
+		next[m->producer]++;
+		n++;
+	}
+	uint64_t ns = benchNowNs() - t0;
+	for(size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+	BENCH_CHECK(queue->pop() == 0);
+
+	char label[128];
+	snprintf(label, sizeof(label), "%s %2d producers (%llu notifies)", name, producers, (unsigned long long)notifies.load());
+	benchReport(label, total, ns);
+	//消息在vector中, 析构前已取空
+	delete queue;
+}
+}
+
+int main(int argc, char* argv[])
+{
+	const uint64_t total = argc > 1 ? (uint64_t)atoll(argv[1]) : 4000000;
+	const int maxProducers = argc > 2 ? atoi(argv[2]) : 32;
+	printf("messages per run: %llu hardware threads: %u\n", (unsigned long long)total, std::thread::hardware_concurrency());
+	for(int p = 1; p <= maxProducers; p *= 2)
+		run<MpscQueue<Message, CountingNotifier> >("MpscQueue", p, total / p);
+	for(int p = 1; p <= maxProducers; p *= 2)
+		run<MessageQueue<Message, CountingNotifier> >("MessageQueue", p, total / p);
+	return 0;
+}
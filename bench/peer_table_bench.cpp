@@ -0,0 +1,180 @@
+//PeerTable基准: 1M对端的插入/命中/未命中查找, 大量删除产生墓碑后的查找, 多线程并发查找
+//对照组为原来的实现: 一把自旋锁保护的std::map
+#include <map>
+#include <vector>
+#include <thread>
+#include <random>
+#include <algorithm>
+#include "core/peer_table.h"
+#include "bench.h"
+
+using namespace net;
+
+namespace
+{
+class MapTable
+{
+public:
+	bool find(const uint64_t key, SOCKET& s, uint32_t& connId)
+	{
+		lin_io::ScopLock<lin_io::SpinLock> sync(_lock);
+		std::map<uint64_t, std::pair<SOCKET,uint32_t> >::iterator it = _sockets.find(key);
+		if(it == _sockets.end())
+			return false;
+		s = it->second.first;
+		connId = it->second.second;
+		return true;
+	}
+	void insert(const uint64_t key, const SOCKET s, const uint32_t connId)
+	{
+		lin_io::ScopLock<lin_io::SpinLock> sync(_lock);
+		_sockets[key] = std::make_pair(s, connId);
+	}
+	bool erase(const uint64_t key)
+	{
+		lin_io::ScopLock<lin_io::SpinLock> sync(_lock);
+		return _sockets.erase(key) > 0;
+	}
+	size_t size()
+	{
+		lin_io::ScopLock<lin_io::SpinLock> sync(_lock);
+		return _sockets.size();
+	}
+private:
+	lin_io::SpinLock _lock;
+	std::map<uint64_t, std::pair<SOCKET,uint32_t> > _sockets;
+};
+
+//模拟对端地址: 10.x.x.x上的随机端口
+uint64_t peerKey(std::mt19937_64& rng)
+{
+	uint32_t ip = 0x0A000000 | (uint32_t)(rng() & 0xFFFFFF);
+	int port = 1024 + (int)(rng() % 60000);
+	return PeerTable::makeKey(ip, port);
+}
+
+std::vector<uint64_t> uniqueKeys(const size_t n, std::mt19937_64& rng)
+{
+	std::vector<uint64_t> keys;
+	keys.reserve(n + n / 8);
+	while(keys.size() < n)
+	{
+		for(size_t i = keys.size(); i < n + n / 16; i++)
+			keys.push_back(peerKey(rng));
+		std::sort(keys.begin(), keys.end());
+		keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+	}
+	keys.resize(n);
+	std::shuffle(keys.begin(), keys.end(), rng);
+	return keys;
+}
+
+template<typename Table>
+void run(const char* name, const size_t peers, const int churnRounds, const int threads)
+{
+	std::mt19937_64 rng(42);
+	std::vector<uint64_t> keys = uniqueKeys(peers * 2, rng);
+	std::vector<uint64_t> live(keys.begin(), keys.begin() + peers);
+	std::vector<uint64_t> spare(keys.begin() + peers, keys.end());
+	Table* table = new Table();
+	char label[128];
+	SOCKET s;
+	uint32_t connId;
+
+	uint64_t t0 = benchNowNs();
+	for(size_t i = 0; i < live.size(); i++)
+		table->insert(live[i], (SOCKET)(i + 3), (uint32_t)i);
+	snprintf(label, sizeof(label), "%s insert", name);
+	benchReport(label, live.size(), benchNowNs() - t0);
+	BENCH_CHECK(table->size() == peers);
+
+	std::vector<uint64_t> order(live);
+	std::shuffle(order.begin(), order.end(), rng);
+	t0 = benchNowNs();
+	size_t hits = 0;
+	for(size_t i = 0; i < order.size(); i++)
+		hits += table->find(order[i], s, connId);
+	snprintf(label, sizeof(label), "%s find hit", name);
+	benchReport(label, order.size(), benchNowNs() - t0);
+	BENCH_CHECK(hits == peers);
+
+	t0 = benchNowNs();
+	hits = 0;
+	for(size_t i = 0; i < spare.size(); i++)
+		hits += table->find(spare[i], s, connId);
+	snprintf(label, sizeof(label), "%s find miss", name);
+	benchReport(label, spare.size(), benchNowNs() - t0);
+	BENCH_CHECK(hits == 0);
+
+	//每轮删除一半对端再换新对端加入, 开放寻址表中留下大量墓碑
+	uint64_t churnNs = 0, churnOps = 0;
+	for(int round = 0; round < churnRounds; round++)
+	{
+		std::shuffle(live.begin(), live.end(), rng);
+		const size_t half = live.size() / 2;
+		t0 = benchNowNs();
+		for(size_t i = 0; i < half; i++)
+		{
+			BENCH_CHECK(table->erase(live[i]));
+			table->insert(spare[i], (SOCKET)(i + 3), (uint32_t)i);
+		}
+		churnNs += benchNowNs() - t0;
+		churnOps += half * 2;
+		for(size_t i = 0; i < half; i++)
+			std::swap(live[i], spare[i]);
+	}
+	snprintf(label, sizeof(label), "%s churn erase+insert", name);
+	benchReport(label, churnOps, churnNs);
+	BENCH_CHECK(table->size() == peers);
+
+	order = live;
+	std::shuffle(order.begin(), order.end(), rng);
+	t0 = benchNowNs();
+	hits = 0;
+	for(size_t i = 0; i < order.size(); i++)
+		hits += table->find(order[i], s, connId);
+	snprintf(label, sizeof(label), "%s find hit after churn", name);
+	benchReport(label, order.size(), benchNowNs() - t0);
+	BENCH_CHECK(hits == peers);
+
+	t0 = benchNowNs();
+	hits = 0;
+	for(size_t i = 0; i < spare.size(); i++)
+		hits += table->find(spare[i], s, connId);
+	snprintf(label, sizeof(label), "%s find miss after churn", name);
+	benchReport(label, spare.size(), benchNowNs() - t0);
+	BENCH_CHECK(hits == 0);
+
+	//多个IO线程同时按对端地址查找
+	std::vector<std::thread> workers;
+	t0 = benchNowNs();
+	for(int t = 0; t < threads; t++)
+	{
+		workers.push_back(std::thread([&, t]() {
+			SOCKET ts;
+			uint32_t tc;
+			size_t n = 0;
+			for(size_t i = t; i < order.size() * 2; i += threads)
+				n += table->find(order[i % order.size()], ts, tc);
+			BENCH_CHECK(n > 0);
+		}));
+	}
+	for(size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+	snprintf(label, sizeof(label), "%s find hit %d threads", name, threads);
+	benchReport(label, order.size() * 2, benchNowNs() - t0);
+
+	delete table;
+}
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t peers = argc > 1 ? (size_t)atol(argv[1]) : 1000000;
+	const int rounds = argc > 2 ? atoi(argv[2]) : 10;
+	const int threads = argc > 3 ? atoi(argv[3]) : 8;
+	printf("peers: %zu churn rounds: %d threads: %d\n", peers, rounds, threads);
+	run<PeerTable>("PeerTable", peers, rounds, threads);
+	run<MapTable>("map+spinlock", peers, rounds, threads);
+	return 0;
+}
@@ -0,0 +1,116 @@
+//PendingTable基准: 连接上10万个在途调用, 响应按序/乱序到达时的取出+新调用登记
+//对照组为原来的实现: 序号转成字符串后存std::map
+#include <map>
+#include <string>
+#include <vector>
+#include <random>
+#include "core/pending_table.h"
+#include "bench.h"
+
+using namespace net;
+
+namespace
+{
+class BenchFuture : public IFuture
+{
+public:
+	virtual long tick() {return 0;}
+protected:
+	virtual void done() {}
+};
+
+class MapTable
+{
+public:
+	bool insert(const uint64_t sn, IFuture* future, IFuturevar& old)
+	{
+		IFuturevar& slot = _futures[std::to_string(sn)];
+		const bool replaced = slot.ptr() != 0;
+		old = slot;
+		slot = future;
+		return replaced;
+	}
+	bool take(const uint64_t sn, IFuturevar& future)
+	{
+		std::map<std::string, IFuturevar>::iterator it = _futures.find(std::to_string(sn));
+		if(it == _futures.end())
+			return false;
+		future = it->second;
+		_futures.erase(it);
+		return true;
+	}
+	size_t size() const {return _futures.size();}
+private:
+	std::map<std::string, IFuturevar> _futures;
+};
+
+template<typename Table>
+void run(const char* name, const size_t inflight, const size_t ops)
+{
+	std::vector<IFuturevar> futures;
+	for(size_t i = 0; i < inflight; i++)
+		futures.push_back(IFuturevar(new BenchFuture()));
+	Table* table = new Table();
+	char label[128];
+	IFuturevar old;
+	IFuturevar future;
+
+	uint64_t t0 = benchNowNs();
+	for(size_t i = 0; i < inflight; i++)
+		table->insert(i + 1, futures[i].ptr(), old);
+	snprintf(label, sizeof(label), "%s fill %zu in-flight", name, inflight);
+	benchReport(label, inflight, benchNowNs() - t0);
+	BENCH_CHECK(table->size() == inflight);
+
+	//响应按发送顺序到达: 取出最早的, 同一个future用新序号再次发起
+	uint64_t next = inflight + 1;
+	t0 = benchNowNs();
+	for(size_t i = 0; i < ops; i++, next++)
+	{
+		BENCH_CHECK(table->take(next - inflight, future));
+		table->insert(next, future.ptr(), old);
+	}
+	snprintf(label, sizeof(label), "%s in-order take+insert", name);
+	benchReport(label, ops, benchNowNs() - t0);
+
+	//响应乱序到达
+	std::vector<uint64_t> sns;
+	for(uint64_t sn = next - inflight; sn < next; sn++)
+		sns.push_back(sn);
+	std::mt19937_64 rng(9);
+	std::vector<size_t> picks(ops);
+	for(size_t i = 0; i < ops; i++)
+		picks[i] = rng() % inflight;
+	t0 = benchNowNs();
+	for(size_t i = 0; i < ops; i++, next++)
+	{
+		uint64_t& sn = sns[picks[i]];
+		BENCH_CHECK(table->take(sn, future));
+		table->insert(next, future.ptr(), old);
+		sn = next;
+	}
+	snprintf(label, sizeof(label), "%s random take+insert", name);
+	benchReport(label, ops, benchNowNs() - t0);
+
+	//超时/断开时按序号查不到
+	t0 = benchNowNs();
+	size_t hits = 0;
+	for(size_t i = 0; i < ops; i++)
+		hits += table->take(next + i, future);
+	snprintf(label, sizeof(label), "%s miss", name);
+	benchReport(label, ops, benchNowNs() - t0);
+	BENCH_CHECK(hits == 0 && table->size() == inflight);
+
+	delete table;
+}
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t inflight = argc > 1 ? (size_t)atol(argv[1]) : 100000;
+	const size_t ops = argc > 2 ? (size_t)atol(argv[2]) : 2000000;
+	printf("in-flight calls: %zu ops: %zu\n", inflight, ops);
+	run<PendingTable>("PendingTable", inflight, ops);
+	run<MapTable>("map<string>", inflight, ops);
+	return 0;
+}
@@ -0,0 +1,121 @@
+//跨线程调度的堆分配计数: 替换malloc统计所有线程的调用次数, 预热(TaskPool缓存达到在途峰值)后
+//每次schedule()和IO线程执行、释放任务都不应再调用malloc
+#include <malloc.h>
+#include <atomic>
+#include <string>
+#include <vector>
+#include "core/scheduler.h"
+#include "bench.h"
+
+using namespace net;
+
+namespace
+{
+std::atomic<uint64_t> mallocs(0);
+std::atomic<uint64_t> executed(0);
+
+//析构时计数: 调用方看到计数时任务已经释放(块已归还), 在途任务数不超过一批
+class CountTask : public Task
+{
+public:
+	virtual ~CountTask() {executed.fetch_add(1, std::memory_order_release);}
+	virtual bool run() {return false;}
+	virtual const char* name() {return "count";}
+};
+
+//每批调度后等待全部释放, 在途任务不超过一批, 也不触发队列长度限制
+const uint64_t BATCH = 10000;
+
+void run(const uint64_t n, const uint32_t hashkey)
+{
+	const uint64_t target = executed.load() + n;
+	const uint64_t batch = BATCH;
+	for(uint64_t i = 0; i < n; i += batch)
+	{
+		const uint64_t end = std::min(n, i + batch);
+		for(uint64_t j = i; j < end; j++)
+		{
+			BENCH_CHECK(Scheduler::instance().schedule(hashkey, new CountTask()));
+		}
+		while(executed.load() < target - (n - end))
+			;
+	}
+}
+}
+
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t n, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+extern "C" void* __libc_memalign(size_t align, size_t size);
+
+extern "C" void* malloc(size_t size)
+{
+	mallocs.fetch_add(1, std::memory_order_relaxed);
+	return __libc_malloc(size);
+}
+extern "C" void* calloc(size_t n, size_t size)
+{
+	mallocs.fetch_add(1, std::memory_order_relaxed);
+	return __libc_calloc(n, size);
+}
+extern "C" void* realloc(void* ptr, size_t size)
+{
+	mallocs.fetch_add(1, std::memory_order_relaxed);
+	return __libc_realloc(ptr, size);
+}
+extern "C" void* memalign(size_t align, size_t size)
+{
+	mallocs.fetch_add(1, std::memory_order_relaxed);
+	return __libc_memalign(align, size);
+}
+extern "C" int posix_memalign(void** ptr, size_t align, size_t size)
+{
+	mallocs.fetch_add(1, std::memory_order_relaxed);
+	*ptr = __libc_memalign(align, size);
+	return *ptr ? 0 : ENOMEM;
+}
+
+int main(int argc, char* argv[])
+{
+	const uint64_t n = argc > 1 ? (uint64_t)atoll(argv[1]) : 1000000;
+	Scheduler::instance().start(2);
+	//等IO线程启动完成(Selector/Manager等线程内对象的分配)
+	run(1000, 1);
+	run(1000, 2);
+
+	//预热: TaskPool按在途任务的峰值分配, 之后复用; 先让一整批同时在途, 缓存达到峰值
+	uint64_t m0 = mallocs.load();
+	std::vector<Task*> tasks;
+	for(uint64_t i = 0; i < BATCH; i++)
+		tasks.push_back(new CountTask());
+	const uint64_t target = executed.load() + BATCH;
+	for(size_t i = 0; i < tasks.size(); i++)
+		BENCH_CHECK(Scheduler::instance().schedule(1, tasks[i]));
+	while(executed.load() < target)
+		;
+	run(n, 1);
+	printf("%-44s %10.4f malloc/op (%llu total)\n", "warm-up", (double)(mallocs.load() - m0) / n, (unsigned long long)(mallocs.load() - m0));
+
+	m0 = mallocs.load();
+	uint64_t t0 = benchNowNs();
+	run(n, 1);
+	uint64_t ns = benchNowNs() - t0;
+	const uint64_t steady = mallocs.load() - m0;
+	benchReport("schedule+run, steady state", n, ns);
+	printf("%-44s %10.4f malloc/op (%llu total)\n", "steady state", (double)steady / n, (unsigned long long)steady);
+
+	//名字为std::string时驻留, 同名不再分配(字符串本身的构造除外)
+	const std::string name("a task name longer than the sso buffer");
+	TaskName first(name);
+	m0 = mallocs.load();
+	for(int i = 0; i < 1000; i++)
+	{
+		BENCH_CHECK(TaskName(name).c_str() == first.c_str());
+	}
+	printf("%-44s %10.4f malloc/op\n", "TaskName(std::string) interned", (mallocs.load() - m0) / 1000.0);
+
+	BENCH_CHECK(steady == 0);
+	fflush(stdout);
+	//IO线程不退出, 直接结束进程
+	_exit(0);
+}
@@ -0,0 +1,311 @@
+#include "arq_session.h"
+#include <string.h>
+#include <arpa/inet.h>
+#include <algorithm>
+#include "log/logger.h"
+
+using namespace net;
+
+namespace
+{
+inline void encode8(std::string& buf, const uint8_t v)
+{
+	buf.push_back((char)v);
+}
+inline void encode16(std::string& buf, const uint16_t v)
+{
+	uint16_t n = htons(v);
+	buf.append((const char*)&n, sizeof(n));
+}
+inline void encode32(std::string& buf, const uint32_t v)
+{
+	uint32_t n = htonl(v);
+	buf.append((const char*)&n, sizeof(n));
+}
+inline uint16_t decode16(const char* p)
+{
+	uint16_t n;
+	memcpy(&n, p, sizeof(n));
+	return ntohs(n);
+}
+inline uint32_t decode32(const char* p)
+{
+	uint32_t n;
+	memcpy(&n, p, sizeof(n));
+	return ntohl(n);
+}
+}
+
+ArqSession::ArqSession(const ArqConfig& config, Output* output)
+: _config(config)
+, _output(output)
+, _mss(config.mtu > HEADER_SIZE ? config.mtu - HEADER_SIZE : 1)
+, _sndUna(0)
+, _sndNxt(0)
+, _rcvNxt(0)
+, _rmtWnd(config.rcvWnd)
+, _srtt(0)
+, _rttvar(0)
+, _rto(std::max(config.minRto, (uint32_t)200))
+, _dead(false)
+, _retransmits(0)
+{
+	_rto = std::min(_rto, _config.maxRto);
+	_datagram.reserve(_config.mtu);
+}
+
+void ArqSession::send(const char* data, const uint32_t size)
+{
+	for(uint32_t offset = 0; offset < size; offset += _mss)
+	{
+		Segment seg;
+		seg.sn = 0;
+		seg.ts = 0;
+		seg.resendts = 0;
+		seg.rto = 0;
+		seg.fastack = 0;
+		seg.xmit = 0;
+		seg.data.assign(data + offset, std::min(_mss, size - offset));
+		_sndQueue.push_back(seg);
+	}
+}
+
+int ArqSession::input(const char* data, const uint32_t size, lin_io::ByteBuffer& stream, const uint32_t now)
+{
+	bool acked = false;
+	uint32_t maxack = 0;
+
+	uint32_t offset = 0;
+	while(size - offset >= HEADER_SIZE)
+	{
+		const char* p = data + offset;
+		uint8_t cmd = (uint8_t)p[0];
+		uint16_t wnd = decode16(p + 2);
+		uint32_t ts = decode32(p + 4);
+		uint32_t sn = decode32(p + 8);
+		uint32_t una = decode32(p + 12);
+		uint32_t len = decode32(p + 16);
+		offset += HEADER_SIZE;
+		if(len > size - offset)
+		{
+			return -1;
+		}
+
+		_rmtWnd = wnd;
+		parseUna(una);
+
+		if(cmd == CMD_ACK)
+		{
+			if(diff(now, ts) >= 0)
+			{
+				updateRtt(diff(now, ts));
+			}
+			parseAck(sn);
+			if(!acked || diff(sn, maxack) > 0)
+			{
+				maxack = sn;
+				acked = true;
+			}
+		}
+		else if(cmd == CMD_PUSH)
+		{
+			if(diff(sn, _rcvNxt + _config.rcvWnd) < 0)
+			{
+				_acks.push_back(std::make_pair(sn, ts));
+				if(diff(sn, _rcvNxt) >= 0 && _rcvBuf.find(sn) == _rcvBuf.end())
+				{
+					_rcvBuf[sn].assign(p + HEADER_SIZE, len);
+				}
+			}
+		}
+		else
+		{
+			return -1;
+		}
+		offset += len;
+	}
+	shrink();
+
+	if(acked)
+	{
+		parseFastack(maxack);
+	}
+
+	//按序交付
+	int delivered = 0;
+	for(std::map<uint32_t, std::string>::iterator it = _rcvBuf.find(_rcvNxt); it != _rcvBuf.end(); it = _rcvBuf.find(_rcvNxt))
+	{
+		stream.write(it->second.data(), it->second.size());
+		delivered += (int)it->second.size();
+		_rcvBuf.erase(it);
+		_rcvNxt++;
+	}
+	return delivered;
+}
+
+bool ArqSession::update(const uint32_t now)
+{
+	if(_dead)
+	{
+		return false;
+	}
+
+	//确认收到的分段
+	for(size_t i = 0; i < _acks.size(); i++)
+	{
+		encode(CMD_ACK, _acks[i].second, _acks[i].first, 0, 0);
+	}
+	_acks.clear();
+
+	//窗口内的新分段进入发送缓冲, 对端窗口为0时仍保留1个分段用于探测
+	uint32_t cwnd = std::max(std::min(_config.sndWnd, _rmtWnd), (uint32_t)1);
+	while(!_sndQueue.empty() && diff(_sndNxt, _sndUna + cwnd) < 0)
+	{
+		_sndBuf.push_back(_sndQueue.front());
+		_sndQueue.pop_front();
+		_sndBuf.back().sn = _sndNxt++;
+	}
+
+	for(std::deque<Segment>::iterator it = _sndBuf.begin(); it != _sndBuf.end(); ++it)
+	{
+		Segment& seg = *it;
+		bool needsend = false;
+		if(seg.xmit == 0)
+		{
+			needsend = true;
+			seg.rto = _rto;
+			seg.resendts = now + seg.rto;
+		}
+		else if(diff(now, seg.resendts) >= 0)
+		{
+			//超时重传: RTO按1.5倍退避
+			needsend = true;
+			seg.rto = std::min(seg.rto + std::max(seg.rto, _rto) / 2, _config.maxRto);
+			seg.resendts = now + seg.rto;
+			_retransmits++;
+		}
+		else if(_config.fastResend > 0 && seg.fastack >= _config.fastResend)
+		{
+			needsend = true;
+			seg.fastack = 0;
+			seg.resendts = now + seg.rto;
+			_retransmits++;
+		}
+
+		if(needsend)
+		{
+			seg.xmit++;
+			seg.ts = now;
+			encode(CMD_PUSH, seg.ts, seg.sn, seg.data.data(), (uint32_t)seg.data.size());
+			if(seg.xmit >= _config.deadLink)
+			{
+				_dead = true;
+			}
+		}
+	}
+	emit();
+
+	if(_dead)
+	{
+		GLWARN << "arq dead link, una: " << _sndUna << " rto: " << _rto << " retransmits: " << _retransmits;
+	}
+	return !_dead;
+}
+
+void ArqSession::updateRtt(const int32_t rtt)
+{
+	if(_srtt == 0)
+	{
+		_srtt = rtt;
+		_rttvar = rtt / 2;
+	}
+	else
+	{
+		int32_t delta = rtt > _srtt ? rtt - _srtt : _srtt - rtt;
+		_rttvar = (3 * _rttvar + delta) / 4;
+		_srtt = (7 * _srtt + rtt) / 8;
+		if(_srtt < 1)
+		{
+			_srtt = 1;
+		}
+	}
+	uint32_t rto = (uint32_t)_srtt + std::max(_config.interval, (uint32_t)(4 * _rttvar));
+	_rto = std::min(std::max(rto, _config.minRto), _config.maxRto);
+}
+
+void ArqSession::parseUna(const uint32_t una)
+{
+	while(!_sndBuf.empty() && diff(_sndBuf.front().sn, una) < 0)
+	{
+		_sndBuf.pop_front();
+	}
+}
+
+void ArqSession::parseAck(const uint32_t sn)
+{
+	if(diff(sn, _sndUna) < 0 || diff(sn, _sndNxt) >= 0)
+	{
+		return;
+	}
+	for(std::deque<Segment>::iterator it = _sndBuf.begin(); it != _sndBuf.end(); ++it)
+	{
+		if(it->sn == sn)
+		{
+			_sndBuf.erase(it);
+			break;
+		}
+		if(diff(sn, it->sn) < 0)
+		{
+			break;
+		}
+	}
+}
+
+//比|sn|小且未确认的分段被跳过一次
+void ArqSession::parseFastack(const uint32_t sn)
+{
+	for(std::deque<Segment>::iterator it = _sndBuf.begin(); it != _sndBuf.end() && diff(it->sn, sn) < 0; ++it)
+	{
+		it->fastack++;
+	}
+}
+
+void ArqSession::shrink()
+{
+	_sndUna = _sndBuf.empty() ? _sndNxt : _sndBuf.front().sn;
+}
+
+uint16_t ArqSession::window() const
+{
+	return _rcvBuf.size() < _config.rcvWnd ? (uint16_t)std::min(_config.rcvWnd - (uint32_t)_rcvBuf.size(), (uint32_t)0xFFFF) : 0;
+}
+
+//多个分段合并到一个数据报, 超过mtu时先发出
+void ArqSession::encode(const uint8_t cmd, const uint32_t ts, const uint32_t sn, const char* data, const uint32_t len)
+{
+	if(!_datagram.empty() && _datagram.size() + HEADER_SIZE + len > _config.mtu)
+	{
+		emit();
+	}
+	encode8(_datagram, cmd);
+	encode8(_datagram, 0);
+	encode16(_datagram, window());
+	encode32(_datagram, ts);
+	encode32(_datagram, sn);
+	encode32(_datagram, _rcvNxt);
+	encode32(_datagram, len);
+	if(len > 0)
+	{
+		_datagram.append(data, len);
+	}
+}
+
+void ArqSession::emit()
+{
+	if(_datagram.empty())
+	{
+		return;
+	}
+	_output->output(_datagram.data(), (uint32_t)_datagram.size());
+	_datagram.clear();
+}
@@ -0,0 +1,121 @@
+#ifndef __NET_ARQ_SESSION_H__
+#define __NET_ARQ_SESSION_H__
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include "utils/int_types.h"
+#include "utils/bytebuffer.h"
+
+namespace net
+{
+//可靠UDP配置(时间单位为毫秒)
+struct ArqConfig
+{
+	uint32_t mtu = 1400;      //单个数据报最大长度(包括分段头)
+	uint32_t interval = 10;   //定时刷新间隔
+	uint32_t minRto = 30;     //重传超时下限
+	uint32_t maxRto = 5000;   //重传超时上限
+	uint32_t sndWnd = 128;    //发送窗口(分段数)
+	uint32_t rcvWnd = 128;    //接收窗口(分段数)
+	uint32_t fastResend = 2;  //被跳过多少次ACK后快速重传, 0为关闭
+	uint32_t deadLink = 20;   //单个分段最大发送次数, 超过认为链路断开
+};
+
+//KCP风格的ARQ会话: 选择确认(逐分段ACK + 累计una)、快速重传、RTO下限可配
+//按字节流有序交付, 不保留send()的消息边界; 只在IO线程中使用
+//
+//分段格式(网络字节序):
+//  +-----+-----+-------+------+------+------+------+--------+
+//  | cmd | pad |  wnd  |  ts  |  sn  |  una |  len |  data  |
+//  |  1  |  1  |   2   |  4   |  4   |  4   |  4   |  len   |
+//  +-----+-----+-------+------+------+------+------+--------+
+class ArqSession
+{
+public:
+	enum
+	{
+		CMD_PUSH = 81,
+		CMD_ACK = 82,
+		HEADER_SIZE = 20,
+	};
+
+	//底层数据报发送
+	struct Output
+	{
+		virtual ~Output() {}
+		virtual void output(const char* data, const uint32_t size) = 0;
+	};
+
+	ArqSession(const ArqConfig& config, Output* output);
+	~ArqSession() {}
+
+	//上层数据按mss切分后放入发送队列, 在下次update()时发出
+	void send(const char* data, const uint32_t size);
+
+	//处理收到的数据报, 按序到达的数据追加到|stream|
+	//返回交付的字节数, -1为数据报格式错误
+	int input(const char* data, const uint32_t size, lin_io::ByteBuffer& stream, const uint32_t now);
+
+	//发送ACK、新分段以及超时/快速重传的分段; 返回false表示链路已断开
+	bool update(const uint32_t now);
+
+	//未确认和未发送的分段数量
+	uint32_t waitSend() const {return (uint32_t)(_sndBuf.size() + _sndQueue.size());}
+	uint32_t getRto() const {return _rto;}
+	uint32_t getInterval() const {return _config.interval;}
+	uint64_t getRetransmits() const {return _retransmits;}
+	bool isDead() const {return _dead;}
+
+private:
+	struct Segment
+	{
+		uint32_t sn;
+		uint32_t ts;
+		uint32_t resendts;
+		uint32_t rto;
+		uint32_t fastack;
+		uint32_t xmit;
+		std::string data;
+	};
+
+	static int32_t diff(const uint32_t a, const uint32_t b) {return (int32_t)(a - b);}
+
+	void updateRtt(const int32_t rtt);
+	void parseUna(const uint32_t una);
+	void parseAck(const uint32_t sn);
+	void parseFastack(const uint32_t sn);
+	void shrink();
+	uint16_t window() const;
+
+	void encode(const uint8_t cmd, const uint32_t ts, const uint32_t sn, const char* data, const uint32_t len);
+	void emit();
+
+private:
+	ArqConfig _config;
+	Output*   _output;
+	uint32_t  _mss;
+
+	uint32_t _sndUna;
+	uint32_t _sndNxt;
+	uint32_t _rcvNxt;
+	uint32_t _rmtWnd;
+
+	int32_t  _srtt;
+	int32_t  _rttvar;
+	uint32_t _rto;
+
+	bool     _dead;
+	uint64_t _retransmits;
+
+	std::deque<Segment> _sndQueue;
+	std::deque<Segment> _sndBuf;
+	std::map<uint32_t, std::string> _rcvBuf;
+	std::vector<std::pair<uint32_t, uint32_t> > _acks;//sn, ts
+
+	std::string _datagram;
+};
+}
+
+#endif
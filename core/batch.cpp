@@ -0,0 +1,196 @@
+#include "batch.h"
+#include "scheduler.h"
+#include "manager.h"
+#include "connection.h"
+#include "call_context.h"
+
+using namespace net;
+
+namespace
+{
+//IO任务: 一次发送全部请求, 再一次登记全部序号
+class BatchTask : public Task
+{
+public:
+	BatchTask(const uint32_t connid, SendBuffer* buffer)
+	:_connid(connid), _buffer(buffer)
+	{
+	}
+	virtual ~BatchTask() {}
+
+	void add(const SeqNo& sn, BatchFuture* future)
+	{
+		_sns.push_back(sn);
+		_futures.push_back(BatchFuturevar(future));
+	}
+
+	virtual bool run()
+	{
+		try
+		{
+			execute();
+		}
+		catch(RuntimeException& e)
+		{
+			GLERROR << "batch call exception: " << e.getCode() << " " << e.what();
+			fail(e);
+		}
+		catch(std::exception& e)
+		{
+			GLERROR << "batch call exception: " << e.what();
+			fail(RuntimeException(RpcException::INTERNAL_ERROR, e.what()));
+		}
+		catch(...)
+		{
+			GLERROR << "batch call exception: unknown error";
+			fail(RuntimeException(RpcException::INTERNAL_ERROR));
+		}
+		return false;
+	}
+	virtual const char* name() {return "batch_call";}
+
+private:
+	void execute()
+	{
+		//所有调用的超时相同, 一起判断是否在队列中过期
+		long tmo = 0;
+		for(size_t i = 0; i < _futures.size(); i++)
+		{
+			tmo = _futures[i]->tick();
+		}
+		if(tmo <= 0)
+		{
+			GLWARN << "connid " << _connid << " batch expired in queue, skip sending";
+			throw RuntimeException(RpcException::IO_BUSY);
+		}
+		Connection* conn = dynamic_cast<Connection*>(Manager::get()->getConnection(_connid));
+		if(!conn)
+		{
+			GLWARN << "connid:" << _connid << " closed";
+			throw RuntimeException(RpcException::CONNECTION_CLOSED);
+		}
+
+		conn->send(_buffer.ptr());
+		for(size_t i = 0; i < _futures.size(); i++)
+		{
+			if(_sns[i].numeric)
+				conn->push(_sns[i].num, _futures[i].ptr());
+			else
+				conn->push(_sns[i].str, _futures[i].ptr());
+		}
+	}
+
+	void fail(const RuntimeException& e)
+	{
+		for(size_t i = 0; i < _futures.size(); i++)
+		{
+			_futures[i]->set_exception(e);
+		}
+	}
+
+private:
+	uint32_t                    _connid;
+	SendBuffervar               _buffer;
+	std::vector<SeqNo>          _sns;
+	std::vector<BatchFuturevar> _futures;
+};
+}
+
+void BatchState::finish(const bool success)
+{
+	if(!success)
+	{
+		_failed.fetch_add(1);
+	}
+	if(_pending.fetch_sub(1) == 1)
+	{
+		_waiter.wake();
+	}
+}
+
+void BatchState::wait()
+{
+	//批量作用域内先提交暂存的IO任务
+	Scheduler::instance().flush();
+	//状态先于唤醒更新: 重置后重新检查, 不会丢失唤醒
+	while(!settled())
+	{
+		_waiter.wait();
+		_waiter.reset();
+	}
+}
+
+//------------------
+void BatchFuture::start(const int ms)
+{
+	_t0 = lin_io::nowUs()/1000;
+	_tms = ms;
+}
+
+long BatchFuture::tick()
+{
+	int64_t now(lin_io::nowUs()/1000);//ms
+	if (now>_t0)
+		_tms -= (now-_t0);
+	_t0 = now;
+	_deadline = now + _tms;
+	return _tms;
+}
+
+void BatchFuture::done()
+{
+	_state->finish(promise().ex.getCode() == 0);
+}
+
+//------------------
+Batch::Batch(const uint32_t connid)
+:_connid(connid)
+,_state(new BatchState())
+,_buffer(new SendBuffer())
+,_called(false)
+{
+}
+
+size_t Batch::call(const int ms) throw_exceptions
+{
+	if(_called)
+	{
+		GLERROR << "connid: " << _connid << " batch already called";
+		throw RuntimeException(RpcException::APP_ERR_CODE);
+	}
+	_called = true;
+
+	const int tmo = CallContext::current().clamp(ms);
+	GLINFO << "connid: " << _connid << " batch size: " << _calls.size() << " sync wait timeout(ms): " << tmo;
+	if(tmo <= 0)
+	{
+		throw RuntimeException(RpcException::TIMEOUT, "deadline exceeded before call");
+	}
+
+	//序列化失败的调用已经结束, 不发送
+	BatchTask* task = new BatchTask(_connid, _buffer.ptr());
+	int launched = 0;
+	for(size_t i = 0; i < _calls.size(); i++)
+	{
+		BatchFuture* future = _calls[i].future.ptr();
+		if(future->promise().done)
+			continue;
+		future->start(tmo);
+		task->add(_calls[i].sn, future);
+		launched++;
+	}
+	if(launched == 0)
+	{
+		delete task;
+		return 0;
+	}
+
+	_state->launch(launched);
+	if(!Scheduler::instance().scheduleConnection(_connid, task))
+	{
+		throw RuntimeException(RpcException::WORKER_QUEUE_FULL);
+	}
+	_state->wait();
+
+	return (size_t)(launched - _state->failed());
+}
@@ -0,0 +1,134 @@
+#ifndef __NET_BATCH_H__
+#define __NET_BATCH_H__
+
+#include <atomic>
+#include <vector>
+#include "utils/packet.h"
+#include "log/logger.h"
+#include "future.h"
+#include "waiter.h"
+#include "send_buffer.h"
+#include "task_pool.h"
+
+namespace net
+{
+//批量调用的共享状态: 所有已发起的调用结束(成功/失败/超时)时唤醒调用方
+class BatchState : public lin_io::LockedRefCount
+{
+public:
+	BatchState():_pending(0),_failed(0) {}
+	virtual ~BatchState() {}
+
+	void launch(const int n) {_pending.fetch_add(n);}
+	//一个调用结束, 在IO线程执行
+	void finish(const bool success);
+
+	bool settled() const {return _pending.load() <= 0;}
+	int failed() const {return _failed.load();}
+	//等待全部结束, 每个调用都有截止时间, 由连接保证结束
+	void wait();
+
+private:
+	std::atomic<int> _pending;
+	std::atomic<int> _failed;
+	Waiter _waiter;
+};
+
+//批量调用中的一个调用: 只作为连接上按序号等待的表项, 响应直接写到调用方的对象
+class BatchFuture : public IFuture
+{
+public:
+	BatchFuture(BatchState* state):_state(state),_t0(0),_tms(0) {}
+	virtual ~BatchFuture() {}
+
+	//发起前设置超时
+	void start(const int ms);
+	virtual long tick();
+
+	static void* operator new(size_t size) {return TaskPool::alloc(size);}
+	static void operator delete(void* ptr) {TaskPool::free(ptr);}
+protected:
+	virtual void done();
+private:
+	lin_io::RcVar<BatchState> _state;
+	int64_t _t0;
+	int64_t _tms;
+};
+typedef lin_io::RcVar<BatchFuture> BatchFuturevar;
+
+//批量调用: 同一连接上的多个请求按顺序序列化到一个发送缓冲区,
+//一个IO任务发送(一次写入)并一次登记全部序号, 调用方只等待一次
+//用法:
+//    Batch batch = Interface(connid).batch();
+//    batch.add(1u, req1, rsp1).add(2u, req2, rsp2);
+//    size_t ok = batch.call(100);//成功的个数, 失败的调用用code(i)查看
+//注意: 不能在IO线程中调用; 每个Batch只能call一次
+class Batch
+{
+public:
+	explicit Batch(const uint32_t connid);
+	~Batch() {}
+
+	template<typename Request,typename Reply>
+	Batch& add(const SeqNo& sn, const Request& req, Reply& rsp)
+	{
+		BatchFuturevar future(new BatchFuture(_state.ptr()));
+		future->promise().set_sn(sn).set_connection(_connid).set_codec(new Promise::VariedResponse<Reply>(rsp));
+		_calls.push_back(Call(sn, future.ptr()));
+
+		if(sn.empty())
+		{
+			GLERROR << "connid: " << _connid << " batch call sn is empty";
+			future->promise().set_exception(RuntimeException(RpcException::APP_ERR_CODE));
+			return *this;
+		}
+
+		//失败时回退到本次写入之前, 不影响其他请求
+		lin_io::ByteBuffer& bb = _buffer->buffer();
+		const size_t mark = bb.size();
+		bool ok = false;
+		try
+		{
+			lin_io::Pack pack(&bb);
+			ok = req.serialize(pack);
+		}
+		catch(std::exception& e)
+		{
+			GLWARN << "connid:" << _connid << " batch serialize exception: " << e.what();
+		}
+		if(!ok)
+		{
+			GLWARN << "connid:" << _connid << " sn: " << sn.toString() << " batch serialize failed";
+			bb.resize(mark);
+			future->promise().set_exception(RuntimeException(RpcException::PROTOCOL_ERROR));
+		}
+		return *this;
+	}
+
+	size_t size() const {return _calls.size();}
+
+	//发送并等待全部响应, 返回成功的个数
+	//截止时间已过或IO队列满时抛出异常, 单个调用的失败不抛出
+	size_t call(const int ms=1000) throw_exceptions;
+
+	//第|i|个调用的结果, 0表示成功
+	int code(const size_t i) const {return _calls[i].future->promise().ex.getCode();}
+	const RuntimeException& exception(const size_t i) const {return _calls[i].future->promise().ex;}
+
+private:
+	struct Call
+	{
+		Call(const SeqNo& s, BatchFuture* f):sn(s),future(f) {}
+		SeqNo           sn;
+		BatchFuturevar  future;
+	};
+
+	uint32_t                  _connid;
+	lin_io::RcVar<BatchState> _state;
+	SendBuffervar             _buffer;
+	std::vector<Call>         _calls;
+	bool                      _called;
+};
+}
+
+#endif
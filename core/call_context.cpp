@@ -0,0 +1,58 @@
+#include "call_context.h"
+#include "coroutine.h"
+
+using namespace net;
+
+namespace
+{
+//主协程用线程变量, 子协程存在协程自己的存储里, 协程切换时不会串用
+thread_local CallContext* t_current = 0;
+
+pthread_key_t contextKey()
+{
+	static pthread_key_t key = []()
+	{
+		pthread_key_t k;
+		pthread_key_create(&k, 0);
+		return k;
+	}();
+	return key;
+}
+
+CallContext* getCurrent()
+{
+	if(lin_io::Coroutine* co = lin_io::Coroutine::running())
+		return static_cast<CallContext*>(co->getspecific(contextKey()));
+	return t_current;
+}
+
+void setCurrent(CallContext* ctx)
+{
+	if(lin_io::Coroutine* co = lin_io::Coroutine::running())
+		co->setspecific(contextKey(), ctx);
+	else
+		t_current = ctx;
+}
+}
+
+CallContext CallContext::current()
+{
+	CallContext* ctx = getCurrent();
+	return ctx ? *ctx : CallContext();
+}
+
+CallContext::Scope::Scope(const CallContext& ctx)
+:_ctx(ctx)
+,_prev(getCurrent())
+{
+	if(_prev)
+	{
+		_ctx = _ctx.min(*_prev);
+	}
+	setCurrent(&_ctx);
+}
+
+CallContext::Scope::~Scope()
+{
+	setCurrent(_prev);
+}
@@ -0,0 +1,77 @@
+#ifndef __NET_CALL_CONTEXT_H__
+#define __NET_CALL_CONTEXT_H__
+
+#include "utils/int_types.h"
+#include "utils/utility.h"
+
+namespace net
+{
+//调用上下文: 携带整条调用链的截止时间(毫秒, 与lin_io::nowUs()同一时钟, 可以跨进程传递)
+//当前上下文内发起的call/async_call/hedged_call的超时不超过剩余时间, 已过期的调用直接失败不再发送
+//异步调用的回调在发起时的上下文中执行, 嵌套调用继承同一截止时间
+//
+//服务端用法: 从请求中取出调用方的截止时间, 设置后再处理
+//    CallContext::Scope scope(CallContext(req.deadline));
+//    if(CallContext::current().expired()) return;//调用方已经超时, 不再处理
+class CallContext
+{
+public:
+	CallContext():_deadline(0) {}
+	explicit CallContext(const int64_t deadline):_deadline(deadline) {}
+	//从现在起|ms|毫秒后截止
+	static CallContext after(const int ms) {return CallContext(lin_io::nowUs()/1000 + ms);}
+
+	//0表示没有截止时间
+	int64_t deadline() const {return _deadline;}
+	bool expired() const {return _deadline > 0 && lin_io::nowUs()/1000 >= _deadline;}
+	//剩余时间(毫秒), 没有截止时间返回-1, 已过期返回0
+	int remaining() const
+	{
+		if(_deadline <= 0)
+			return -1;
+		int64_t left = _deadline - lin_io::nowUs()/1000;
+		return left > 0 ? (int)left : 0;
+	}
+	//本次调用的超时: 不超过剩余时间, 已过期返回0
+	int clamp(const int ms) const
+	{
+		int left = remaining();
+		if(left < 0)
+			return ms;
+		return left < ms ? left : ms;
+	}
+	//与另一个截止时间取较早的
+	CallContext min(const CallContext& o) const
+	{
+		if(_deadline <= 0)
+			return o;
+		if(o._deadline <= 0 || _deadline <= o._deadline)
+			return *this;
+		return o;
+	}
+
+	//当前线程(协程)的上下文, 没有设置时没有截止时间
+	static CallContext current();
+
+	class Scope;
+
+private:
+	int64_t _deadline;
+};
+
+//在作用域内设置当前上下文, 嵌套时取较早的截止时间, 退出时恢复
+class CallContext::Scope
+{
+public:
+	explicit Scope(const CallContext& ctx);
+	~Scope();
+private:
+	Scope(const Scope&);
+	void operator=(const Scope&);
+
+	CallContext _ctx;
+	CallContext* _prev;
+};
+}
+
+#endif
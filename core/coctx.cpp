@@ -0,0 +1,126 @@
+#include "coctx.h"
+
+#ifdef COROUTINE_USE_ASM
+#include <stdint.h>
+
+#if defined(__x86_64__)
+//栈上布局(从低到高): mxcsr/x87控制字, r15, r14, r13, r12, rbx, rbp, 返回地址
+__asm__(
+	".text\n"
+	".globl lin_coctx_swap\n"
+	".type lin_coctx_swap,@function\n"
+	".p2align 4\n"
+	"lin_coctx_swap:\n"
+	"	pushq %rbp\n"
+	"	pushq %rbx\n"
+	"	pushq %r12\n"
+	"	pushq %r13\n"
+	"	pushq %r14\n"
+	"	pushq %r15\n"
+	"	subq $8, %rsp\n"
+	"	stmxcsr (%rsp)\n"
+	"	fnstcw 4(%rsp)\n"
+	"	movq %rsp, (%rdi)\n"
+	"	movq (%rsi), %rsp\n"
+	"	ldmxcsr (%rsp)\n"
+	"	fldcw 4(%rsp)\n"
+	"	addq $8, %rsp\n"
+	"	popq %r15\n"
+	"	popq %r14\n"
+	"	popq %r13\n"
+	"	popq %r12\n"
+	"	popq %rbx\n"
+	"	popq %rbp\n"
+	"	ret\n"
+	".size lin_coctx_swap,.-lin_coctx_swap\n"
+	"\n"
+	//第一次切换进来: r12 = fn, r13 = arg
+	".globl lin_coctx_entry\n"
+	".type lin_coctx_entry,@function\n"
+	".p2align 4\n"
+	"lin_coctx_entry:\n"
+	"	movq %r13, %rdi\n"
+	"	callq *%r12\n"
+	"	ud2\n"
+	".size lin_coctx_entry,.-lin_coctx_entry\n"
+);
+
+#elif defined(__aarch64__)
+//栈上布局(从低到高): x19-x28, x29(fp), x30(lr), d8-d15
+__asm__(
+	".text\n"
+	".globl lin_coctx_swap\n"
+	".type lin_coctx_swap,%function\n"
+	".p2align 4\n"
+	"lin_coctx_swap:\n"
+	"	sub sp, sp, #160\n"
+	"	stp x19, x20, [sp, #0]\n"
+	"	stp x21, x22, [sp, #16]\n"
+	"	stp x23, x24, [sp, #32]\n"
+	"	stp x25, x26, [sp, #48]\n"
+	"	stp x27, x28, [sp, #64]\n"
+	"	stp x29, x30, [sp, #80]\n"
+	"	stp d8, d9, [sp, #96]\n"
+	"	stp d10, d11, [sp, #112]\n"
+	"	stp d12, d13, [sp, #128]\n"
+	"	stp d14, d15, [sp, #144]\n"
+	"	mov x2, sp\n"
+	"	str x2, [x0]\n"
+	"	ldr x2, [x1]\n"
+	"	mov sp, x2\n"
+	"	ldp x19, x20, [sp, #0]\n"
+	"	ldp x21, x22, [sp, #16]\n"
+	"	ldp x23, x24, [sp, #32]\n"
+	"	ldp x25, x26, [sp, #48]\n"
+	"	ldp x27, x28, [sp, #64]\n"
+	"	ldp x29, x30, [sp, #80]\n"
+	"	ldp d8, d9, [sp, #96]\n"
+	"	ldp d10, d11, [sp, #112]\n"
+	"	ldp d12, d13, [sp, #128]\n"
+	"	ldp d14, d15, [sp, #144]\n"
+	"	add sp, sp, #160\n"
+	"	ret\n"
+	".size lin_coctx_swap,.-lin_coctx_swap\n"
+	"\n"
+	//第一次切换进来: x19 = fn, x20 = arg
+	".globl lin_coctx_entry\n"
+	".type lin_coctx_entry,%function\n"
+	".p2align 4\n"
+	"lin_coctx_entry:\n"
+	"	mov x0, x20\n"
+	"	blr x19\n"
+	"	brk #0\n"
+	".size lin_coctx_entry,.-lin_coctx_entry\n"
+);
+#endif
+
+extern "C" void lin_coctx_entry();
+
+void lin_io::coctx_make(coctx* ctx, void* stack, const size_t size, void (*fn)(void*), void* arg)
+{
+	//栈顶按16字节对齐
+	uintptr_t top = ((uintptr_t)stack + size) & ~(uintptr_t)15;
+#if defined(__x86_64__)
+	//entry执行时rsp = top, call之前满足16字节对齐
+	uint64_t* sp = (uint64_t*)(top - 64);
+	sp[0] = (uint64_t)0x1F80 | ((uint64_t)0x037F << 32);//mxcsr, x87控制字的默认值
+	sp[1] = 0;              //r15
+	sp[2] = 0;              //r14
+	sp[3] = (uint64_t)arg;  //r13
+	sp[4] = (uint64_t)fn;   //r12
+	sp[5] = 0;              //rbx
+	sp[6] = 0;              //rbp
+	sp[7] = (uint64_t)lin_coctx_entry;
+#else
+	uint64_t* sp = (uint64_t*)(top - 160);
+	for(int i = 0; i < 20; i++)
+	{
+		sp[i] = 0;
+	}
+	sp[0] = (uint64_t)fn;   //x19
+	sp[1] = (uint64_t)arg;  //x20
+	sp[11] = (uint64_t)lin_coctx_entry;//x30
+#endif
+	ctx->sp = sp;
+}
+#endif
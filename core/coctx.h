@@ -0,0 +1,33 @@
+#ifndef __NET_COCTX_H__
+#define __NET_COCTX_H__
+
+#include <stddef.h>
+
+//协程上下文切换: x86-64上用汇编只保存被调用者保存的寄存器, 切换不进入内核
+//swapcontext每次切换都要调用rt_sigprocmask保存/恢复信号屏蔽字, 协程不依赖信号屏蔽字, 不需要
+//aarch64的实现还没有在真机上跑过, 需要定义COROUTINE_USE_ASM_AARCH64才启用
+//其他平台、开启split stack或定义COROUTINE_USE_UCONTEXT时仍使用ucontext
+#if !defined(COROUTINE_USE_UCONTEXT) && !defined(USE_SPLIT_STACKS) && defined(__ELF__) \
+	&& (defined(__x86_64__) || (defined(__aarch64__) && defined(COROUTINE_USE_ASM_AARCH64)))
+#define COROUTINE_USE_ASM
+#endif
+
+#ifdef COROUTINE_USE_ASM
+namespace lin_io
+{
+//切换时寄存器压在各自的栈上, 上下文只保存栈顶
+struct coctx
+{
+	coctx():sp(0) {}
+	void* sp;
+};
+
+//在[stack, stack+size)上构造初始上下文, 第一次切换进来时执行fn(arg); fn不能返回
+void coctx_make(coctx* ctx, void* stack, const size_t size, void (*fn)(void*), void* arg);
+}
+
+//保存当前上下文到|from|, 切换到|to|
+extern "C" void lin_coctx_swap(lin_io::coctx* from, lin_io::coctx* to);
+#endif
+
+#endif
@@ -6,6 +6,7 @@
 #include <iostream>
 #include <string.h>
 #include <unistd.h>
+#include <time.h>
 #include <sys/syscall.h>
 #include <netdb.h>
 #include <ifaddrs.h>
@@ -14,6 +15,43 @@
 
 namespace net
 {
+//连接ID: 最高位为标记, 其后8位为所属IO线程(Scheduler中的序号), 低23位为线程内序号
+//Scheduler::scheduleConnection(connid, ...)按所属线程直接路由, schedule(hashkey, ...)不识别连接ID
+const uint32_t CONNID_FLAG = 0x80000000;
+const uint32_t CONNID_OWNER_SHIFT = 23;
+const uint32_t CONNID_OWNER_MASK = 0xFF;
+const uint32_t CONNID_SEQ_MASK = 0x7FFFFF;
+
+inline uint32_t makeConnId(const uint32_t owner, const uint32_t seq)
+{
+	return CONNID_FLAG | ((owner & CONNID_OWNER_MASK) << CONNID_OWNER_SHIFT) | (seq & CONNID_SEQ_MASK);
+}
+
+inline bool isConnId(const uint32_t id)
+{
+	return (id & CONNID_FLAG) != 0;
+}
+
+inline uint32_t getConnIdOwner(const uint32_t connid)
+{
+	return (connid >> CONNID_OWNER_SHIFT) & CONNID_OWNER_MASK;
+}
+
+//普通hashkey在子线程(1 ~ workers-1)间取模, 没有子线程时返回0
+inline uint32_t routeHashKey(const uint32_t hashkey, const uint32_t workers)
+{
+	return workers < 2 ? 0 : hashkey % (workers-1) + 1;
+}
+
+//连接ID路由到所属线程, 所属线程不存在时按普通hashkey取模
+inline uint32_t routeConnId(const uint32_t connid, const uint32_t workers)
+{
+	const uint32_t owner = getConnIdOwner(connid);
+	if(isConnId(connid) && owner < workers)
+		return owner;
+	return routeHashKey(connid, workers);
+}
+
 //判断地址格式是否是IP(xxx.xxx.xxx.xxx格式)
 inline bool isip(const char* s)
 {
@@ -81,6 +119,14 @@ inline pthread_t getThreadId()
     return t_tid;
 }
 
+//单调时钟, 微秒
+inline int64_t getMonotonicUs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((int64_t)ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
 inline int getLocalIp(std::vector<std::string>& ips)
 {
 	struct ifaddrs *ifaddr, *ifa;
@@ -0,0 +1,305 @@
+#include "compute_pool.h"
+#include "common.h"
+#include "log/logger.h"
+
+using namespace net;
+
+WorkStealingDeque::WorkStealingDeque(const uint32_t capacity)
+:_top(0)
+,_bottom(0)
+,_array(new Array(capacity))
+{
+}
+
+WorkStealingDeque::~WorkStealingDeque()
+{
+	delete _array.load(std::memory_order_relaxed);
+	for(auto it = _retired.begin(); it != _retired.end(); it++)
+	{
+		delete *it;
+	}
+}
+
+WorkStealingDeque::Array* WorkStealingDeque::grow(Array* a, const int64_t top, const int64_t bottom)
+{
+	Array* na = new Array(a->capacity * 2);
+	for(int64_t i = top; i < bottom; i++)
+	{
+		na->put(i, a->get(i));
+	}
+	_retired.push_back(a);
+	_array.store(na, std::memory_order_release);
+	return na;
+}
+
+void WorkStealingDeque::push(Task* c)
+{
+	int64_t b = _bottom.load(std::memory_order_relaxed);
+	int64_t t = _top.load(std::memory_order_acquire);
+	Array* a = _array.load(std::memory_order_relaxed);
+	if(b - t > a->capacity - 1)
+	{
+		a = grow(a, t, b);
+	}
+	a->put(b, c);
+	std::atomic_thread_fence(std::memory_order_release);
+	_bottom.store(b + 1, std::memory_order_relaxed);
+}
+
+Task* WorkStealingDeque::pop()
+{
+	int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+	Array* a = _array.load(std::memory_order_relaxed);
+	_bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t t = _top.load(std::memory_order_relaxed);
+	if(t > b)
+	{
+		//已空
+		_bottom.store(b + 1, std::memory_order_relaxed);
+		return 0;
+	}
+
+	Task* c = a->get(b);
+	if(t == b)
+	{
+		//最后一个, 与窃取方竞争
+		if(!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			c = 0;
+		}
+		_bottom.store(b + 1, std::memory_order_relaxed);
+	}
+	return c;
+}
+
+Task* WorkStealingDeque::steal()
+{
+	int64_t t = _top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t b = _bottom.load(std::memory_order_acquire);
+	if(t >= b)
+	{
+		return 0;
+	}
+
+	Array* a = _array.load(std::memory_order_acquire);
+	Task* c = a->get(t);
+	if(!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+	{
+		return 0;
+	}
+	return c;
+}
+
+bool WorkStealingDeque::empty() const
+{
+	return _bottom.load(std::memory_order_relaxed) <= _top.load(std::memory_order_relaxed);
+}
+
+//==========================
+namespace
+{
+//当前线程在计算池中的序号, -1为非计算线程
+int& computeIndex()
+{
+	static thread_local int index = -1;
+	return index;
+}
+
+struct ComputeContext
+{
+	ComputePool* pool;
+	uint32_t index;
+};
+
+void* compute_loop_routine(void* ptr)
+{
+	ComputeContext* ctx = (ComputeContext*)ptr;
+	ComputePool* pool = ctx->pool;
+	uint32_t index = ctx->index;
+	delete ctx;
+
+	computeIndex() = (int)index;
+	pool->run(index);
+	return NULL;
+}
+}
+
+ComputePool::ComputePool()
+:_quit(false)
+,_pending(0)
+,_sleepers(0)
+{
+}
+
+ComputePool::~ComputePool()
+{
+}
+
+void ComputePool::start(const int num)
+{
+	if(!_threads.empty())
+	{
+		GLINFO << "compute pool is running, thread size: " << _threads.size();
+		return;
+	}
+
+	_quit = false;
+	for(int i = 0; i < num; i++)
+	{
+		_threads.push_back(new ComputeThread);
+	}
+	for(int i = 0; i < num; i++)
+	{
+		ComputeContext* ctx = new ComputeContext;
+		ctx->pool = this;
+		ctx->index = i;
+		int ret = pthread_create(&_threads[i]->tid, NULL, compute_loop_routine, ctx);
+		if(ret != 0)
+		{
+			GLERROR << "create compute thread error: " << ret;
+			delete ctx;
+		}
+	}
+	GLINFO << "start compute thread size: " << num;
+}
+
+void ComputePool::stop()
+{
+	if(_threads.empty())
+		return;
+
+	_quit = true;
+	{
+		lin_io::ScopLock<lin_io::Condition> sync(_cond);
+		_cond.notifyAll();
+	}
+	for(auto it = _threads.begin(); it != _threads.end(); it++)
+	{
+		if((*it)->tid)
+			pthread_join((*it)->tid, NULL);
+	}
+
+	//丢弃未执行的任务
+	for(auto it = _threads.begin(); it != _threads.end(); it++)
+	{
+		for(Task* c = (*it)->tasks.pop(); c; c = (*it)->tasks.pop())
+		{
+			delete c;
+		}
+		delete *it;
+	}
+	_threads.clear();
+
+	lin_io::ScopLock<lin_io::SpinLock> sync(_lock);
+	for(auto it = _injected.begin(); it != _injected.end(); it++)
+	{
+		delete *it;
+	}
+	_injected.clear();
+	_pending = 0;
+}
+
+bool ComputePool::submit(Task* c)
+{
+	if(_quit || _threads.empty())
+	{
+		GLERROR << "compute pool is not running, add task failed, name: " << c->name();
+		delete c;
+		return false;
+	}
+
+	int index = computeIndex();
+	if(index >= 0 && index < (int)_threads.size())
+	{
+		_threads[index]->tasks.push(c);
+	}
+	else
+	{
+		lin_io::ScopLock<lin_io::SpinLock> sync(_lock);
+		_injected.push_back(c);
+	}
+
+	//有空闲线程时唤醒一个
+	_pending.fetch_add(1);
+	if(_sleepers.load() > 0)
+	{
+		lin_io::ScopLock<lin_io::Condition> sync(_cond);
+		_cond.notify();
+	}
+	return true;
+}
+
+//顺序: 本线程队列 -> 公共队列 -> 窃取其他线程
+Task* ComputePool::take(const uint32_t index)
+{
+	Task* c = _threads[index]->tasks.pop();
+	if(c)
+		return c;
+
+	{
+		lin_io::ScopLock<lin_io::SpinLock> sync(_lock);
+		if(!_injected.empty())
+		{
+			c = _injected.front();
+			_injected.pop_front();
+			return c;
+		}
+	}
+
+	const uint32_t size = _threads.size();
+	for(uint32_t i = 1; i < size; i++)
+	{
+		c = _threads[(index + i) % size]->tasks.steal();
+		if(c)
+			return c;
+	}
+	return 0;
+}
+
+void ComputePool::execute(Task* c)
+{
+	try
+	{
+		if(!c->run())
+		{
+			delete c;
+		}
+	}
+	catch(const std::exception& e)
+	{
+		GLERROR << "compute task name: " << c->name() << " happen error: " << e.what();
+		delete c;
+	}
+	catch(...)
+	{
+		GLERROR << "compute task name: " << c->name() << " happen error";
+		delete c;
+	}
+}
+
+void ComputePool::run(const uint32_t index)
+{
+	GLINFO << "compute thread start, id: " << index << " thread id: " << net::getThreadId();
+	while(!_quit)
+	{
+		Task* c = take(index);
+		if(c)
+		{
+			_pending.fetch_sub(1);
+			execute(c);
+			continue;
+		}
+
+		lin_io::ScopLock<lin_io::Condition> sync(_cond);
+		_sleepers.fetch_add(1);
+		//窃取可能因竞争失败, 超时后重新检查
+		if(!_quit && _pending.load() <= 0)
+		{
+			_cond.wait(100);
+		}
+		_sleepers.fetch_sub(1);
+	}
+	GLINFO << "compute thread stop, id: " << index << " thread id: " << net::getThreadId();
+}
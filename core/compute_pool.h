@@ -0,0 +1,178 @@
+#ifndef __NET_COMPUTE_POOL_H__
+#define __NET_COMPUTE_POOL_H__
+
+#include <deque>
+#include <vector>
+#include <atomic>
+#include "thread.h"
+#include "scheduler.h"
+
+//计算线程池: 与IO线程分开, 用于解码/业务逻辑等耗CPU的任务, 不阻塞epoll分发
+namespace net
+{
+//Chase-Lev工作窃取双端队列: 属主线程在底部push/pop, 其他线程从顶部steal
+class WorkStealingDeque
+{
+public:
+	WorkStealingDeque(const uint32_t capacity = 1024);
+	~WorkStealingDeque();
+
+	//属主线程调用
+	void push(Task* c);
+	Task* pop();
+
+	//任意线程调用, 为空或竞争失败返回0
+	Task* steal();
+
+	bool empty() const;
+
+private:
+	struct Array
+	{
+		Array(const int64_t cap):capacity(cap),mask(cap-1),slots(new std::atomic<Task*>[cap]) {}
+		~Array() {delete [] slots;}
+		Task* get(const int64_t i) const {return slots[i & mask].load(std::memory_order_relaxed);}
+		void put(const int64_t i, Task* c) {slots[i & mask].store(c, std::memory_order_relaxed);}
+
+		int64_t capacity;
+		int64_t mask;
+		std::atomic<Task*>* slots;
+	};
+
+	Array* grow(Array* a, const int64_t top, const int64_t bottom);
+
+private:
+	std::atomic<int64_t> _top;
+	char _pad[64];//窃取方和属主不共享缓存行
+	std::atomic<int64_t> _bottom;
+	std::atomic<Array*> _array;
+	std::vector<Array*> _retired;//扩容后的旧数组, 窃取方可能还在读, 析构时释放
+};
+
+template<typename OBJ, typename REQ, typename RSP>
+class Offloader : public Task
+{
+public:
+	Offloader(const uint32_t connid, OBJ* obj, void(OBJ::*compute)(const REQ& req, RSP& rsp), void(OBJ::*complete)(const RSP& rsp), const REQ& req, const TaskName& name)
+	:_connid(connid),_obj(obj),_compute(compute),_complete(complete),_req(req),_name(name.c_str())
+	{
+	}
+	virtual bool run()
+	{
+		RSP rsp;
+		(_obj->*_compute)(_req, rsp);
+		Scheduler::instance().scheduleConnection(_connid, _obj, _complete, rsp, _name);
+		return false;
+	}
+	virtual const char* name() {return _name;}
+private:
+	uint32_t _connid;//结果投递回该连接所属的IO线程
+	OBJ* _obj;
+	void(OBJ::*_compute)(const REQ& req, RSP& rsp);
+	void(OBJ::*_complete)(const RSP& rsp);
+	REQ _req;
+	const char* _name;
+};
+
+template<typename REQ, typename RSP>
+class Offloader<void,REQ,RSP> : public Task
+{
+public:
+	Offloader(const uint32_t connid, void(*compute)(const REQ& req, RSP& rsp), void(*complete)(const RSP& rsp), const REQ& req, const TaskName& name)
+	:_connid(connid),_compute(compute),_complete(complete),_req(req),_name(name.c_str())
+	{
+	}
+	virtual bool run()
+	{
+		RSP rsp;
+		(*_compute)(_req, rsp);
+		Scheduler::instance().scheduleConnection(_connid, _complete, rsp, _name);
+		return false;
+	}
+	virtual const char* name() {return _name;}
+private:
+	uint32_t _connid;//结果投递回该连接所属的IO线程
+	void(*_compute)(const REQ& req, RSP& rsp);
+	void(*_complete)(const RSP& rsp);
+	REQ _req;
+	const char* _name;
+};
+
+class ComputePool
+{
+	ComputePool();
+public:
+	static ComputePool& instance()
+	{
+		static ComputePool ins;
+		return ins;
+	}
+
+	virtual ~ComputePool();
+
+	void start(const int num);
+	void stop();
+
+	//计算任务调度: 在计算线程内提交进入本线程队列, 否则进入公共队列
+	bool submit(Task* c);
+	template<typename ARG>
+	bool submit(void(*fun)(const ARG& req), const ARG& req, const TaskName& name="task")
+	{
+		return submit(new Executor<void,ARG>(fun, req, name));
+	}
+	template<typename OBJ,typename ARG>
+	bool submit(OBJ* obj, void(OBJ::*fun)(const ARG& req), const ARG& req, const TaskName& name="task")
+	{
+		return submit(new Executor<OBJ,ARG>(obj, fun, req, name));
+	}
+
+	//计算结果投递回连接|connid|所属的IO线程(同Scheduler::scheduleConnection)
+	bool postBack(const uint32_t connid, Task* c)
+	{
+		return Scheduler::instance().scheduleConnection(connid, c);
+	}
+
+	//在计算线程执行compute, 完成后在连接|connid|所属的IO线程执行complete
+	template<typename REQ, typename RSP>
+	bool offload(const uint32_t connid, void(*compute)(const REQ& req, RSP& rsp), void(*complete)(const RSP& rsp), const REQ& req, const TaskName& name="task")
+	{
+		return submit(new Offloader<void,REQ,RSP>(connid, compute, complete, req, name));
+	}
+	template<typename OBJ, typename REQ, typename RSP>
+	bool offload(const uint32_t connid, OBJ* obj, void(OBJ::*compute)(const REQ& req, RSP& rsp), void(OBJ::*complete)(const RSP& rsp), const REQ& req, const TaskName& name="task")
+	{
+		return submit(new Offloader<OBJ,REQ,RSP>(connid, obj, compute, complete, req, name));
+	}
+
+	uint32_t getThreadSize() {return _threads.size();}
+	bool empty() {return _threads.empty();}
+
+	void run(const uint32_t index);
+
+private:
+	Task* take(const uint32_t index);
+	void execute(Task* c);
+
+private:
+	struct ComputeThread
+	{
+		ComputeThread():tid(0) {}
+		pthread_t tid;
+		WorkStealingDeque tasks;
+	};
+
+	std::atomic<bool> _quit;
+	std::vector<ComputeThread*> _threads;
+
+	//非计算线程提交的任务
+	lin_io::SpinLock _lock;
+	std::deque<Task*> _injected;
+
+	//空闲线程休眠
+	lin_io::Condition _cond;
+	std::atomic<long> _pending;
+	std::atomic<long> _sleepers;
+};
+}
+
+#endif
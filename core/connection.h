@@ -2,6 +2,8 @@
 #define ___NET_CONNECTION_H__
 
 #include <map>
+#include <vector>
+#include <algorithm>
 #include <memory>
 #include <stdio.h>
 #include <cstring>
@@ -13,6 +15,11 @@
 
 #include "selector.h"
 #include "future.h"
+#include "pending_table.h"
+#include "send_buffer.h"
+#include "recv_slice.h"
+#include "arq_session.h"
+#include "peer_table.h"
 
 namespace net
 {
@@ -59,6 +66,8 @@ public:
 	virtual int onData(const char* data, const uint32_t size, IConnection* conn) = 0;
 	//需要发心跳时回调
 	virtual void onHeartbeat(IConnection* conn) = 0;
+	//连接迁移到其他IO线程后回调(在新线程执行), 之后使用conn->getConnId()的新连接ID
+	virtual void onMigrated(const uint32_t oldConnId, IConnection* conn) {}
 };
 typedef lin_io::RcVar<IClientHandler> IClientHandler_var;
 
@@ -67,44 +76,33 @@ class ISocketManager : public lin_io::LockedRefCount
 public:
     SOCKET find(const u_long peerIp, const int peerPort)
     {
-    	uint64_t key = ((uint64_t)peerIp<<32) | peerPort;
-    	lin_io::ScopLock<lin_io::SpinLock> sync(_lock);
-    	auto it = _sockets.find(key);
-    	return it != _sockets.end() ? it->second.first : 0;
+    	SOCKET s = 0;
+    	uint32_t connId = 0;
+    	_sockets.find(PeerTable::makeKey(peerIp, peerPort), s, connId);
+    	return s;
     }
     void add(const u_long peerIp, const int peerPort, const SOCKET s)
     {
-    	uint64_t key = ((uint64_t)peerIp<<32) | peerPort;
-    	lin_io::ScopLock<lin_io::SpinLock> sync(_lock);
-    	_sockets[key] = std::make_pair(s, 0);
+    	_sockets.insert(PeerTable::makeKey(peerIp, peerPort), s, 0);
     }
     void remove(const u_long peerIp, const int peerPort)
     {
-    	uint64_t key = ((uint64_t)peerIp<<32) | peerPort;
-    	lin_io::ScopLock<lin_io::SpinLock> sync(_lock);
-    	_sockets.erase(key);
+    	_sockets.erase(PeerTable::makeKey(peerIp, peerPort));
     }
 public:
     bool setConnId(const u_long peerIp, const int peerPort, const uint32_t connId)
     {
-    	uint64_t key = ((uint64_t)peerIp<<32) | peerPort;
-    	lin_io::ScopLock<lin_io::SpinLock> sync(_lock);
-    	auto it = _sockets.find(key);
-    	if(it == _sockets.end())
-    		return false;
-    	it->second.second = connId;
-    	return true;
+    	return _sockets.setConnId(PeerTable::makeKey(peerIp, peerPort), connId);
     }
     uint32_t getConnId(const u_long peerIp, const int peerPort)
     {
-    	uint64_t key = ((uint64_t)peerIp<<32) | peerPort;
-    	lin_io::ScopLock<lin_io::SpinLock> sync(_lock);
-    	auto it = _sockets.find(key);
-    	return it != _sockets.end() ? it->second.second : 0;
+    	SOCKET s = 0;
+    	uint32_t connId = 0;
+    	_sockets.find(PeerTable::makeKey(peerIp, peerPort), s, connId);
+    	return connId;
     }
 private:
-    lin_io::SpinLock _lock;
-	std::map<uint64_t, std::pair<SOCKET,uint32_t> > _sockets;
+	PeerTable _sockets;
 };
 typedef lin_io::RcVar<ISocketManager> ISocketManager_var;
 
@@ -141,6 +139,18 @@ struct IConnection : public lin_io::LockedRefCount
     // 可用send(0,0)来返回当前output buffer size
     // 网络连接断开或Connection的输出缓冲满，抛出异常
     virtual uint32_t send(const char* data, const uint32_t sz) throw_exceptions = 0;
+    // 发送已序列化的数据, 返回值同上; 连接可以只保留引用, 默认拷贝发送
+    virtual uint32_t send(SendBuffer* buffer) throw_exceptions
+    {
+        return send(buffer->data(), buffer->size());
+    }
+
+    // 在onData回调中为收到的响应帧[data, data+size)创建切片, 返回的对象引用计数为0
+    // 响应可以直接引用切片中的数据交给future, 不再深拷贝; 默认拷贝一份
+    virtual RecvSlice* slice(const char* data, const uint32_t size)
+    {
+        return RecvSlice::copy(data, size);
+    }
 
     //获取和设置接收超时时间
     virtual int getKeepaliveTimeout() = 0;
@@ -153,27 +163,44 @@ typedef lin_io::RcVar<IConnection> IConnection_var;
 
 struct Connection : public IConnection
 {
+	enum
+	{
+		COMPACT_THRESHOLD = 64,//截止时间堆超过该大小且大部分已完成时压缩
+	};
+
+	Connection():_deadlineTimer(this, &Connection::expire),_armed(0) {}
 	virtual ~Connection()
 	{
 		clear();
 	}
 
-	bool pop(const uint32_t sn, IFuturevar& future) {return pop(std::to_string(sn), future);}
-	bool pop(const uint64_t sn, IFuturevar& future) {return pop(std::to_string(sn), future);}
+	//整数序号走整数表, 字符串序号走map; 两边互相兜底, 保证同一序号用哪种形式都能取到
+	bool pop(const uint32_t sn, IFuturevar& future) {return pop((uint64_t)sn, future);}
+	bool pop(const uint64_t sn, IFuturevar& future)
+	{
+		if(_calls.take(sn, future))
+			return true;
+		return !_futures.empty() && popString(std::to_string(sn), future);
+	}
 	bool pop(const std::string& sn, IFuturevar& future)
 	{
-		Futures::iterator it = _futures.find(sn);
-		if (it != _futures.end())
-		{
-			future = it->second;
-			_futures.erase(it);
+		if(popString(sn, future))
 			return true;
-		}
-		return false;
+		uint64_t num = 0;
+		return !_calls.empty() && toNumber(sn, num) && _calls.take(num, future);
 	}
 
-	bool push(const uint32_t sn, IFuture* future) {return push(std::to_string(sn), future);}
-	bool push(const uint64_t sn, IFuture* future) {return push(std::to_string(sn), future);}
+	bool push(const uint32_t sn, IFuture* future) {return push((uint64_t)sn, future);}
+	bool push(const uint64_t sn, IFuture* future)
+	{
+		IFuturevar old;
+		if(_calls.insert(sn, future, old))
+		{
+			old->set_exception(RuntimeException(RpcException::INTERNAL_ERROR, "repeat sequence"));
+		}
+		watch(future);
+		return true;
+	}
 	bool push(const std::string& sn, IFuture* future)
 	{
 		Futures::iterator it = _futures.find(sn);
@@ -185,16 +212,217 @@ struct Connection : public IConnection
 
 		IFuturevar ref(future);
 		_futures[sn] = ref;
+		watch(future);
 		return true;
 	}
+	void remove(const uint64_t sn)
+	{
+		_calls.erase(sn);
+	}
 	void remove(const std::string& sn)
 	{
 		_futures.erase(sn);
 	}
+	void remove(const Promise& promise)
+	{
+		if(promise.numeric)
+			remove(promise.seq);
+		else
+			remove(promise.sn);
+	}
+	//撤销等待中的|future|, 之后到达的响应被丢弃
+	bool cancel(IFuture* future)
+	{
+		return unlink(future);
+	}
+
+protected:
+	//有协程调用在等待时连接不能迁移
+	bool hasPinnedFutures() const
+	{
+		for(size_t i = 0; i < _calls.capacity(); i++)
+		{
+			if(_calls.at(i) && _calls.at(i)->pinned())
+				return true;
+		}
+		for(Futures::const_iterator it = _futures.begin(); it != _futures.end(); it++)
+		{
+			if(it->second->pinned())
+				return true;
+		}
+		return false;
+	}
+
+	//连接迁移: 原IO线程摘除超时定时器, 新IO线程按新连接ID更新future并重新挂定时器
+	//截止时间是绝对时间, 迁移不影响剩余时间
+	void detachFutures()
+	{
+		_deadlineTimer.stop();
+		_armed = 0;
+	}
+	void attachFutures(const uint32_t connid)
+	{
+		for(size_t i = 0; i < _calls.capacity(); i++)
+		{
+			if(_calls.at(i))
+				_calls.at(i)->attach(connid);
+		}
+		for(Futures::iterator it = _futures.begin(); it != _futures.end(); it++)
+		{
+			it->second->attach(connid);
+		}
+		arm();
+	}
 
 private:
+	bool popString(const std::string& sn, IFuturevar& future)
+	{
+		Futures::iterator it = _futures.find(sn);
+		if (it != _futures.end())
+		{
+			future = it->second;
+			_futures.erase(it);
+			return true;
+		}
+		return false;
+	}
+
+	//与std::to_string(uint64_t)结果一致的字符串才转换, 避免"007"和7混淆
+	static bool toNumber(const std::string& sn, uint64_t& num)
+	{
+		if(sn.empty() || sn.size() > 20 || (sn.size() > 1 && sn[0] == '0'))
+			return false;
+		num = 0;
+		for(size_t i = 0; i < sn.size(); i++)
+		{
+			if(sn[i] < '0' || sn[i] > '9')
+				return false;
+			uint64_t next = num * 10 + (uint64_t)(sn[i] - '0');
+			if(next / 10 != num)
+				return false;
+			num = next;
+		}
+		return true;
+	}
+
+	//从等待表中取出|future|, 表中已经是其他future时放回
+	bool unlink(IFuture* future)
+	{
+		const Promise& promise = future->promise();
+		IFuturevar found;
+		if(promise.numeric)
+		{
+			if(!_calls.take(promise.seq, found))
+				return false;
+			if(found.ptr() != future)
+			{
+				IFuturevar old;
+				_calls.insert(promise.seq, found.ptr(), old);
+				return false;
+			}
+			return true;
+		}
+		Futures::iterator it = _futures.find(promise.sn);
+		if(it == _futures.end() || it->second.ptr() != future)
+			return false;
+		_futures.erase(it);
+		return true;
+	}
+
+	//超时检查: 每个连接一个定时器, 按最早的截止时间挂定时器
+	//完成的调用不从堆中删除, 到期或压缩时丢弃
+	struct Deadline
+	{
+		Deadline(const int64_t at, IFuture* future):at(at),future(future) {}
+		bool operator<(const Deadline& o) const {return at > o.at;}//小顶堆
+		int64_t at;
+		IFuturevar future;
+	};
+
+	void watch(IFuture* future)
+	{
+		if(future->deadline() <= 0)
+			return;
+		_deadlines.push_back(Deadline(future->deadline(), future));
+		std::push_heap(_deadlines.begin(), _deadlines.end());
+		if(_deadlines.size() > COMPACT_THRESHOLD && _deadlines.size() > 2 * (_calls.size() + _futures.size()))
+		{
+			compact();
+		}
+		arm();
+	}
+
+	void compact()
+	{
+		size_t n = 0;
+		for(size_t i = 0; i < _deadlines.size(); i++)
+		{
+			if(!_deadlines[i].future->promise().done)
+				_deadlines[n++] = _deadlines[i];
+		}
+		_deadlines.resize(n, Deadline(0, 0));
+		std::make_heap(_deadlines.begin(), _deadlines.end());
+	}
+
+	void arm()
+	{
+		if(_deadlines.empty())
+		{
+			if(_armed)
+				_deadlineTimer.stop();
+			_armed = 0;
+			return;
+		}
+		const int64_t at = _deadlines.front().at;
+		if(_armed == at)
+			return;
+		int64_t ms = at - lin_io::nowUs()/1000;
+		_deadlineTimer.start((int)std::max(ms, (int64_t)1));
+		_armed = at;
+	}
+
+	//一次取出所有到期的调用, 先整理好堆再设置异常(回调中可能再发起调用或关闭连接)
+	void expire()
+	{
+		lin_io::RcVar<Connection> ref(this);
+		_armed = 0;
+		const int64_t now = lin_io::nowUs()/1000;
+		std::vector<IFuturevar> expired;
+		while(!_deadlines.empty() && _deadlines.front().at <= now)
+		{
+			std::pop_heap(_deadlines.begin(), _deadlines.end());
+			IFuturevar future = _deadlines.back().future;
+			_deadlines.pop_back();
+			if(!future->promise().done && unlink(future.ptr()))
+			{
+				expired.push_back(future);
+			}
+		}
+
+		if(!expired.empty())
+		{
+			std::string desc("timeout " + dump());
+			GLWARN << "connid: " << getConnId() << " " << expired.size() << " calls timeout, first sn: " << expired[0]->promise().get_sn();
+			for(size_t i = 0; i < expired.size(); i++)
+			{
+				expired[i]->set_exception(RuntimeException(RpcException::TIMEOUT, desc));
+			}
+		}
+		arm();
+	}
+
 	void clear()
 	{
+		_deadlineTimer.stop();
+		_armed = 0;
+		_deadlines.clear();
+
+		std::vector<IFuturevar> calls;
+		_calls.takeAll(calls);
+		for(size_t i = 0; i < calls.size(); i++)
+		{
+			calls[i]->set_exception(RuntimeException(RpcException::CONNECTION_CLOSED, "connection closed"));
+		}
 		while(!_futures.empty())
 		{
 			Futures::iterator it = _futures.begin();
@@ -206,6 +434,11 @@ private:
 private:
 	typedef std::map<std::string,IFuturevar> Futures;
 	Futures _futures;
+	PendingTable _calls;
+
+	SimpleTimer<Connection> _deadlineTimer;
+	int64_t _armed;//已挂定时器的截止时间, 0表示未挂
+	std::vector<Deadline> _deadlines;
 };
 typedef lin_io::RcVar<Connection> Connection_var;
 
@@ -221,6 +454,7 @@ struct IClientContext : public lin_io::LockedRefCount
 	//UDP
 	std::string data;
 	ISocketManager_var listener;
+	std::shared_ptr<ArqConfig> arq;//可靠传输配置, 为空不开启
 };
 typedef lin_io::RcVar<IClientContext> IClientContext_var;
 }
@@ -2,6 +2,8 @@
  *  coroutine implement
  *  . 使用 libc的 makecontext/swapcontext 实现,在移植性方面,这几个调用被很多系统废弃
  *    但gcc目前还支持，也能正常使用
+ *  . x86-64上默认使用汇编切换(coctx.h), 不再每次切换调用rt_sigprocmask(aarch64需定义COROUTINE_USE_ASM_AARCH64);
+ *    定义COROUTINE_USE_UCONTEXT或USE_SPLIT_STACKS时仍使用ucontext
  *  . 原语：
  *    co create(function) throws exceptions   --  create a child coroutine
  *    co runing()                             --  return current coroutine
@@ -39,6 +41,7 @@
 #include <sys/mman.h>
 
 #include "thread.h"
+#include "coctx.h"
 #include "utils/rc.h"
 #include "handler.h"
 #include "log/logger.h"
@@ -78,7 +81,7 @@ public:
 class Coroutine : public RefCount
 {
 public:
-	class Timer : Handler
+	class Timer : net::Handler
 	{
 	public:
 		Timer(Coroutine* caller) : _caller(caller) {}
@@ -178,13 +181,19 @@ private:
 	//  context for main coroutine
 	struct MainContext
 	{
+#     ifdef COROUTINE_USE_ASM
+		coctx ctx;//第一次切换出去时保存
+#     else
 		ucontext_t ctx;
+#     endif
 #     ifdef USE_SPLIT_STACKS
 		segments_context ssctx;
 #     endif
 		MainContext()
 		{
+#       ifndef COROUTINE_USE_ASM
 			getcontext(&ctx);
+#       endif
 #       ifdef USE_SPLIT_STACKS
 			__splitstack_getcontext(ssctx);
 #       endif
@@ -198,7 +207,11 @@ private:
 	static ThreadLocal<Coroutine>    _running;
 	static ThreadLocal<MainContext>  _main;
 
+#   ifdef COROUTINE_USE_ASM
+	coctx                       _context;
+#   else
 	ucontext_t                  _context;
+#   endif
 	Stack                       _stack;
 	Arg                         _arg;     /// arguments btween coroutines
 	Proc                        _routine;
@@ -252,6 +265,16 @@ private:
 		/// jump to last resume caller
 	}
 
+#   ifdef COROUTINE_USE_ASM
+	static void _entry(void* p)
+	{
+		Coroutine* self = (Coroutine*)p;
+		_proc(self);
+		/// 没有uc_link, 过程结束后切回最后一次resume的调用方, 不再返回
+		lin_coctx_swap(&self->_context, &_main.get()->ctx);
+	}
+#   endif
+
 	Coroutine(Proc proc, size_t stacksize=8*1024)
 	:_stack(stacksize),_arg(0),_routine(proc),_stat(SUSPENDED)
 	{
@@ -265,11 +288,16 @@ private:
 
 		MainContext* main = _get_main_context();
 
+#     ifdef COROUTINE_USE_ASM
+		(void)main;
+		coctx_make(&_context, _stack.boundary, _stack.size, _entry, this);
+#     else
 		getcontext(&_context);
 		_context.uc_stack.ss_sp = _stack.boundary;
 		_context.uc_stack.ss_size = _stack.size;
 		_context.uc_link = &main->ctx;
 		makecontext(&_context,reinterpret_cast<void (*)(void)>(_proc), 1, this);
+#     endif
 	}
 
 public:
@@ -342,7 +370,12 @@ public:
 #     endif
 
 		//GLINFO << "coroutine: " << self << "--------------------stat NORMAL: swapcontext to main";
+#     ifdef COROUTINE_USE_ASM
+		lin_coctx_swap(&self->_context, &main->ctx);
+		int ret = 0;
+#     else
 		int ret = swapcontext((ucontext_t *)&self->_context, &main->ctx);
+#     endif
 
 #     ifdef USE_SPLIT_STACKS
 		__splitstack_setcontext( self->_stack.ssctx);
@@ -401,7 +434,12 @@ public:
 #     endif
 
 		//GLINFO << "coroutine: " << co << "--------------------swapcontext main->child[_proc]";
+#     ifdef COROUTINE_USE_ASM
+		lin_coctx_swap(&main->ctx, &co->_context);
+		int ret = 0;
+#     else
 		int ret = swapcontext(&main->ctx, &co->_context);
+#     endif
 
 #     ifdef USE_SPLIT_STACKS
 		__splitstack_setcontext(main->ssctx);
@@ -0,0 +1,167 @@
+#include "cpu_affinity.h"
+#include <sched.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include "log/logger.h"
+
+using namespace net;
+
+namespace
+{
+//解析"0-23,48-71"格式
+void parseCpuList(const char* s, std::vector<int>& cpus)
+{
+	while(*s)
+	{
+		char* end = 0;
+		long first = strtol(s, &end, 10);
+		if(end == s)
+			break;
+		long last = first;
+		s = end;
+		if(*s == '-')
+		{
+			last = strtol(s + 1, &end, 10);
+			s = end;
+		}
+		for(long cpu = first; cpu <= last; cpu++)
+		{
+			cpus.push_back((int)cpu);
+		}
+		if(*s == ',')
+			s++;
+		else
+			break;
+	}
+}
+}
+
+CpuTopology::CpuTopology()
+{
+	load();
+}
+
+void CpuTopology::load()
+{
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	if(sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+	{
+		GLWARN << "sched_getaffinity failed: " << errno;
+		return;
+	}
+	for(int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+	{
+		if(CPU_ISSET(cpu, &allowed))
+			_cpus.push_back(cpu);
+	}
+	if(_cpus.empty())
+		return;
+	_cpuNode.assign(_cpus.back() + 1, -1);
+
+	DIR* dir = opendir("/sys/devices/system/node");
+	if(dir)
+	{
+		struct dirent* entry;
+		while((entry = readdir(dir)) != NULL)
+		{
+			int node = -1;
+			if(sscanf(entry->d_name, "node%d", &node) != 1 || node < 0)
+				continue;
+
+			char path[128];
+			snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+			FILE* fp = fopen(path, "r");
+			if(!fp)
+				continue;
+			char line[4096] = {0};
+			if(fgets(line, sizeof(line), fp))
+			{
+				std::vector<int> cpus;
+				parseCpuList(line, cpus);
+				for(size_t i = 0; i < cpus.size(); i++)
+				{
+					if(cpus[i] < (int)_cpuNode.size() && CPU_ISSET(cpus[i], &allowed))
+						_cpuNode[cpus[i]] = node;
+				}
+			}
+			fclose(fp);
+		}
+		closedir(dir);
+	}
+
+	//节点编号可能不连续, 按编号压缩; 没有拓扑信息时全部归为一个节点
+	std::vector<int> ids;
+	for(size_t i = 0; i < _cpus.size(); i++)
+	{
+		int& node = _cpuNode[_cpus[i]];
+		if(node < 0)
+			node = 0;
+		if(node >= (int)ids.size())
+			ids.resize(node + 1, -1);
+		ids[node] = 0;
+	}
+	int next = 0;
+	for(size_t i = 0; i < ids.size(); i++)
+	{
+		if(ids[i] >= 0)
+			ids[i] = next++;
+	}
+	_nodes.resize(next);
+	for(size_t i = 0; i < _cpus.size(); i++)
+	{
+		int& node = _cpuNode[_cpus[i]];
+		node = ids[node];
+		_nodes[node].push_back(_cpus[i]);
+	}
+	GLINFO << "cpu topology, cpu size: " << _cpus.size() << " node size: " << _nodes.size();
+}
+
+int CpuTopology::getNode(const int cpu) const
+{
+	return cpu >= 0 && cpu < (int)_cpuNode.size() ? _cpuNode[cpu] : -1;
+}
+
+std::vector<int> CpuTopology::order(const CpuAffinity policy) const
+{
+	std::vector<int> cpus;
+	if(policy == AFFINITY_COMPACT)
+	{
+		for(size_t n = 0; n < _nodes.size(); n++)
+		{
+			cpus.insert(cpus.end(), _nodes[n].begin(), _nodes[n].end());
+		}
+	}
+	else if(policy == AFFINITY_SPREAD)
+	{
+		for(size_t i = 0; cpus.size() < _cpus.size(); i++)
+		{
+			for(size_t n = 0; n < _nodes.size(); n++)
+			{
+				if(i < _nodes[n].size())
+					cpus.push_back(_nodes[n][i]);
+			}
+		}
+	}
+	return cpus;
+}
+
+bool CpuTopology::bind(const int cpu)
+{
+	if(cpu < 0 || cpu >= CPU_SETSIZE)
+		return false;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	int ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	if(ret != 0)
+	{
+		GLWARN << "bind cpu: " << cpu << " failed: " << ret;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,50 @@
+#ifndef __NET_CPU_AFFINITY_H__
+#define __NET_CPU_AFFINITY_H__
+
+#include <vector>
+#include "utils/int_types.h"
+
+namespace net
+{
+//IO线程绑核策略
+enum CpuAffinity
+{
+	AFFINITY_NONE = 0,    //不绑核
+	AFFINITY_COMPACT = 1, //按NUMA节点依次占满, 线程集中在少数节点
+	AFFINITY_SPREAD = 2,  //在NUMA节点间轮流分配, 线程分散到所有节点
+};
+
+//CPU/NUMA拓扑(读取/sys/devices/system/node), 只包含进程允许运行的CPU
+class CpuTopology
+{
+	CpuTopology();
+public:
+	static CpuTopology& instance()
+	{
+		static CpuTopology ins;
+		return ins;
+	}
+
+	uint32_t getCpuSize() const {return _cpus.size();}
+	uint32_t getNodeSize() const {return _nodes.size();}
+
+	//CPU所在节点, 未知返回-1
+	int getNode(const int cpu) const;
+
+	//按策略排列的CPU序列, 第i个IO线程绑定第i个CPU
+	std::vector<int> order(const CpuAffinity policy) const;
+
+	//当前线程绑定到|cpu|, 之后首次访问的内存分配在本节点上
+	static bool bind(const int cpu);
+
+private:
+	void load();
+
+private:
+	std::vector<int> _cpus;
+	std::vector<std::vector<int> > _nodes;//节点 -> CPU
+	std::vector<int> _cpuNode;//CPU -> 节点
+};
+}
+
+#endif
@@ -1,9 +1,12 @@
 #include "framework.h"
 #include <sys/sysinfo.h>
 #include "log/logger.h"
+#include "common.h"
 
 #include "manager.h"
 #include "scheduler.h"
+#include "compute_pool.h"
+#include "rebalancer.h"
 #include "interface.h"
 #include "tcp_client.h"
 #include "udp_client.h"
@@ -19,7 +22,7 @@ Framework::~Framework()
 {
 }
 
-void Framework::async_start(const int procs)
+void Framework::async_start(const int procs, const CpuAffinity affinity)
 {
 	static bool start(false);
 	if(start)
@@ -35,7 +38,12 @@ void Framework::async_start(const int procs)
 		size = get_nprocs();
 		GLINFO << "no set pool size, cpu core size: " << size;
 	}
-	size = size > 16 ? 16 : size;
+	//连接ID中所属线程占8位
+	if(size > (int)CONNID_OWNER_MASK)
+	{
+		GLWARN << "pool size: " << size << " exceeds max " << CONNID_OWNER_MASK;
+		size = CONNID_OWNER_MASK;
+	}
 	if(size <= 0)
 	{
 		GLERROR << "pool size is 0, exit!";
@@ -43,15 +51,40 @@ void Framework::async_start(const int procs)
 		return;
 	}
 
-	//设置步长(步长为工作线程数量)
-	Manager::init(size);
-
 	//启动N个线程，其中0号为主线程
-	Scheduler::instance().start(size);
+	Scheduler::instance().start(size, affinity);
+}
+
+void Framework::set_task_budget(const uint32_t tasks, const uint32_t us)
+{
+	Scheduler::instance().setBudget(tasks, us);
+}
+
+void Framework::set_admission(const ShedPolicy policy, const uint32_t targetUs, const uint32_t intervalUs)
+{
+	Scheduler::instance().setAdmission(policy, targetUs, intervalUs);
+}
+
+void Framework::start_compute(const int threads)
+{
+	int size(threads);
+	if(size == -1)
+	{
+		size = get_nprocs();
+		GLINFO << "no set compute pool size, cpu core size: " << size;
+	}
+	if(size <= 0)
+	{
+		GLERROR << "compute pool size is 0, not start";
+		return;
+	}
+	ComputePool::instance().start(size);
 }
 
 void Framework::stop()
 {
+	Rebalancer::instance().stop();
+	ComputePool::instance().stop();
 	Scheduler::instance().stop();
 }
 
@@ -85,13 +118,24 @@ void io_thread_create_udp_client(const IClientContext_var& context)
 	UdpClient::create(context);
 }
 
+struct MigrateContext
+{
+	uint32_t connid;
+	uint32_t worker;
+};
+
+void io_thread_migrate_connection(const MigrateContext& ctx)
+{
+	Manager::get()->migrate(ctx.connid, ctx.worker);
+}
+
 bool Framework::createTcpServer(IServerHandler* handler, const int port, const int timeout)
 {
 	IServerContext_var context(new IServerContext);
 	context->port = port;
 	context->handler = handler;
 	context->timeoutMs = timeout;
-	return Scheduler::instance().schedule(io_thread_create_tcp_server, context);
+	return Scheduler::instance().schedule(io_thread_create_tcp_server, context, "createTcpServer", PRIORITY_URGENT);
 }
 
 bool Framework::createTcpServer(IServerHandler* handler, const int port, const int timeout, const uint32_t hashKey)
@@ -101,7 +145,7 @@ bool Framework::createTcpServer(IServerHandler* handler, const int port, const i
 	context->handler = handler;
 	context->hashKey = std::shared_ptr<uint32_t>(new uint32_t(hashKey));
 	context->timeoutMs = timeout;
-	return Scheduler::instance().schedule(io_thread_create_tcp_server, context);
+	return Scheduler::instance().schedule(io_thread_create_tcp_server, context, "createTcpServer", PRIORITY_URGENT);
 }
 
 bool Framework::createTcpClient(IClientHandler* handler, const std::string& host, const int port, const int timeout)
@@ -112,7 +156,7 @@ bool Framework::createTcpClient(IClientHandler* handler, const std::string& host
 	context->peerPort = port;
 	context->handler = handler;
 	context->timeoutMs = timeout;
-	return Scheduler::instance().schedule(_id++, io_thread_create_tcp_client, context);
+	return Scheduler::instance().schedule(_id++, io_thread_create_tcp_client, context, "createTcpClient", PRIORITY_URGENT);
 }
 
 bool Framework::createTcpClient(IClientHandler* handler, const std::string& host, const int port, const int timeout, const uint32_t hashKey)
@@ -122,7 +166,7 @@ bool Framework::createTcpClient(IClientHandler* handler, const std::string& host
 	context->peerPort = port;
 	context->handler = handler;
 	context->timeoutMs = timeout;
-	return Scheduler::instance().schedule(hashKey, io_thread_create_tcp_client, context);
+	return Scheduler::instance().schedule(hashKey, io_thread_create_tcp_client, context, "createTcpClient", PRIORITY_URGENT);
 }
 
 bool Framework::createUdpServer(IServerHandler* handler, const int port, const int timeout)
@@ -131,7 +175,7 @@ bool Framework::createUdpServer(IServerHandler* handler, const int port, const i
 	context->port = port;
 	context->handler = handler;
 	context->timeoutMs = timeout;
-	return Scheduler::instance().schedule(io_thread_create_udp_server, context);
+	return Scheduler::instance().schedule(io_thread_create_udp_server, context, "createUdpServer", PRIORITY_URGENT);
 }
 
 bool Framework::createUdpServer(IServerHandler* handler, const int port, const int timeout, const uint32_t hashKey)
@@ -141,7 +185,7 @@ bool Framework::createUdpServer(IServerHandler* handler, const int port, const i
 	context->handler = handler;
 	context->hashKey = std::shared_ptr<uint32_t>(new uint32_t(hashKey));
 	context->timeoutMs = timeout;
-	return Scheduler::instance().schedule(io_thread_create_udp_server, context);
+	return Scheduler::instance().schedule(io_thread_create_udp_server, context, "createUdpServer", PRIORITY_URGENT);
 }
 
 bool Framework::createUdpServer(IServerHandler* handler, const std::string& ip, const int port, const int timeout)
@@ -151,7 +195,7 @@ bool Framework::createUdpServer(IServerHandler* handler, const std::string& ip,
 	context->port = port;
 	context->handler = handler;
 	context->timeoutMs = timeout;
-	return Scheduler::instance().schedule(io_thread_create_udp_server, context);
+	return Scheduler::instance().schedule(io_thread_create_udp_server, context, "createUdpServer", PRIORITY_URGENT);
 }
 
 bool Framework::createUdpServer(IServerHandler* handler, const std::string& ip, const int port, const int timeout, const uint32_t hashKey)
@@ -162,7 +206,7 @@ bool Framework::createUdpServer(IServerHandler* handler, const std::string& ip,
 	context->handler = handler;
 	context->hashKey = std::shared_ptr<uint32_t>(new uint32_t(hashKey));
 	context->timeoutMs = timeout;
-	return Scheduler::instance().schedule(io_thread_create_udp_server, context);
+	return Scheduler::instance().schedule(io_thread_create_udp_server, context, "createUdpServer", PRIORITY_URGENT);
 }
 
 bool Framework::createUdpClient(IClientHandler* handler, const std::string& host, const int port)
@@ -172,7 +216,7 @@ bool Framework::createUdpClient(IClientHandler* handler, const std::string& host
 	context->peerIP = host;
 	context->peerPort = port;
 	context->handler = handler;
-	return Scheduler::instance().schedule(_id++, io_thread_create_udp_client, context);
+	return Scheduler::instance().schedule(_id++, io_thread_create_udp_client, context, "createUdpClient", PRIORITY_URGENT);
 }
 
 bool Framework::createUdpClient(IClientHandler* handler, const std::string& host, const int port, const uint32_t hashKey)
@@ -181,17 +225,57 @@ bool Framework::createUdpClient(IClientHandler* handler, const std::string& host
 	context->peerIP = host;
 	context->peerPort = port;
 	context->handler = handler;
-	return Scheduler::instance().schedule(hashKey, io_thread_create_udp_client, context);
+	return Scheduler::instance().schedule(hashKey, io_thread_create_udp_client, context, "createUdpClient", PRIORITY_URGENT);
+}
+
+bool Framework::createUdpServer(IServerHandler* handler, const std::string& ip, const int port, const int timeout, const ArqConfig& arq)
+{
+	IServerContext_var context(new IServerContext);
+	context->ip = ip;
+	context->port = port;
+	context->handler = handler;
+	context->timeoutMs = timeout;
+	context->arq = std::shared_ptr<ArqConfig>(new ArqConfig(arq));
+	return Scheduler::instance().schedule(io_thread_create_udp_server, context, "createUdpServer", PRIORITY_URGENT);
+}
+
+bool Framework::createUdpClient(IClientHandler* handler, const std::string& host, const int port, const ArqConfig& arq)
+{
+	static uint32_t _id(0);
+	IClientContext_var context(new IClientContext);
+	context->peerIP = host;
+	context->peerPort = port;
+	context->handler = handler;
+	context->arq = std::shared_ptr<ArqConfig>(new ArqConfig(arq));
+	return Scheduler::instance().schedule(_id++, io_thread_create_udp_client, context, "createUdpClient", PRIORITY_URGENT);
+}
+
+bool Framework::migrate(const uint32_t connid, const uint32_t worker)
+{
+	MigrateContext ctx;
+	ctx.connid = connid;
+	ctx.worker = worker;
+	return Scheduler::instance().scheduleConnection(connid, io_thread_migrate_connection, ctx, "migrate", PRIORITY_URGENT);
+}
+
+bool Framework::start_rebalance(const int intervalMs, const uint32_t threshold, const uint32_t maxConns)
+{
+	return Rebalancer::instance().start(intervalMs, threshold, maxConns);
+}
+
+void Framework::stop_rebalance()
+{
+	Rebalancer::instance().stop();
 }
 
 bool Framework::deleteTcpServer(const int serverId)
 {
-	return Scheduler::instance().schedule(io_thread_delete_tcp_server, serverId);
+	return Scheduler::instance().schedule(io_thread_delete_tcp_server, serverId, "deleteTcpServer", PRIORITY_URGENT);
 }
 
 bool Framework::deleteUdpServer(const int serverId)
 {
-	return Scheduler::instance().schedule(io_thread_delete_udp_server, serverId);
+	return Scheduler::instance().schedule(io_thread_delete_udp_server, serverId, "deleteUdpServer", PRIORITY_URGENT);
 }
 
 bool Framework::deleteTcpClient(const int clientId)
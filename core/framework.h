@@ -2,6 +2,8 @@
 #define __NET_FRAMEWORK_H__
 
 #include "listener.h"
+#include "cpu_affinity.h"
+#include "worker.h"
 namespace net
 {
 class Framework
@@ -17,10 +19,19 @@ public:
 	}
 
 public:
-	//异步启动
-	void async_start(const int procs = -1);
+	//异步启动: procs为IO线程数(-1为CPU核数), affinity为IO线程绑核策略
+	void async_start(const int procs = -1, const CpuAffinity affinity = AFFINITY_NONE);
 	void stop();
 
+	//IO线程每轮事件循环最多处理|tasks|个任务、最多|us|微秒(0为不限), 避免任务风暴阻塞网络事件
+	void set_task_budget(const uint32_t tasks, const uint32_t us);
+
+	//IO线程排队时延在|intervalUs|内都超过|targetUs|时按|policy|快速拒绝任务(Scheduler::lastError()为SCHEDULE_OVERLOAD)
+	void set_admission(const ShedPolicy policy, const uint32_t targetUs, const uint32_t intervalUs);
+
+	//启动计算线程池(与IO线程分开, 见ComputePool), -1为CPU核数
+	void start_compute(const int threads = -1);
+
 	//*协议层接口(协议层的handler已经继承了智能指针，必须要使用new, 框架负责释放内存)
 	//hash值为0为无效, hash值是用来调度服务器接受的连接到哪个线程处理; timeout为连接超时时间, 单位为毫秒
 	bool createTcpServer(IServerHandler* handler, const int port, const int timeoutMs);
@@ -38,6 +49,10 @@ public:
     bool createUdpClient(IClientHandler* handler, const std::string& ip, const int port);
 	bool createUdpClient(IClientHandler* handler, const std::string& ip, const int port, const uint32_t hashKey);
 
+	//可靠UDP: 连接上开启ARQ会话(选择确认、快速重传), 两端都必须使用可靠UDP创建
+	bool createUdpServer(IServerHandler* handler, const std::string& ip, const int port, const int timeoutMs, const ArqConfig& arq);
+	bool createUdpClient(IClientHandler* handler, const std::string& ip, const int port, const ArqConfig& arq);
+
 	//*应用层接口(应用层的handler, 不建议用智能指针管理, 必须要使用new, 框架负责释放内存)
 	template<typename T>
 	bool createTcpServer(typename T::Handler* handler, const int port, const int timeoutMs, const uint32_t hashKey)
@@ -90,6 +105,12 @@ public:
 		return createUdpClient(new T(handler), host, port, timeoutMs, hashKey);
 	}
 
+	//连接迁移: 把TCP连接转移到|worker|号IO线程(1~IO线程数), 连接ID会变化, 新ID通过IClientHandler::onMigrated通知
+	bool migrate(const uint32_t connid, const uint32_t worker);
+	//按IO线程负载自动迁移连接(见Rebalancer), |intervalMs|为采样周期, 最忙线程超过平均值|threshold|%时迁移
+	bool start_rebalance(const int intervalMs, const uint32_t threshold = 50, const uint32_t maxConns = 8);
+	void stop_rebalance();
+
 	//删除接口
 	bool deleteTcpServer(const int serverId);
 	bool deleteUdpServer(const int serverId);
@@ -6,12 +6,18 @@
 
 namespace net
 {
+void ConditionWrapper::yield()
+{
+	Scheduler::instance().flush();
+	_waiter.wait();
+}
+
+//------------------
 Future::Future(const int ms)
-:_enable(false)
-,_t0(lin_io::nowUs()/1000)
+:_t0(lin_io::nowUs()/1000)
 ,_tms(ms)
-,_timer(this, &Future::timeout)
 ,_executor(0)
+,_priority(PRIORITY_NORMAL)
 {
 	if(lin_io::Coroutine::running())
 	{
@@ -33,18 +39,15 @@ long Future::tick()
 	int64_t now(lin_io::nowUs()/1000);//ms
 	if (now>_t0)
 		_tms -= (now-_t0);
-	if(!_enable)
-	{
-		if (_tms > 0)
-			_timer.start(_tms);
-		_enable = true;
-	}
+	_t0 = now;
+	_deadline = now + _tms;
 	return _tms;
 }
 
-bool Future::setup(Task* c)
+bool Future::setup(Task* c, const TaskPriority priority)
 {
 	_executor = c;
+	_priority = priority;
 	return true;
 }
 
@@ -76,12 +79,13 @@ void Future::wait() throw_exceptions
 	//生成IO任务
 	auto executor(_executor);
 	_executor = NULL;
-	if(!Scheduler::instance().schedule(promise().connid, executor))
+	if(!Scheduler::instance().scheduleConnection(promise().connid, executor, _priority))
 	{
 		throw RuntimeException(RpcException::WORKER_QUEUE_FULL);
 	}
 
-	//等待IO或定时器事情
+	//等待IO或定时器事情, 批量作用域内先提交IO任务
+	Scheduler::instance().flush();
 	yield();
 
 	//获取调用结果
@@ -91,38 +95,103 @@ void Future::wait() throw_exceptions
 	}
 }
 
-void Future::timeout()
+void Future::done()
 {
-	if(promise().done)
-		return;
+	resume();
+}
 
-	lin_io::RcVar<Future> ref(this);
-	std::string desc("timeout");
-	Connection* conn = dynamic_cast<Connection*>(Manager::get()->getConnection(promise().connid));
-	if(conn)
+//------------------
+namespace
+{
+//响应在其他协程中到达时, 回到主协程再唤醒
+class WakeupTask : public Task
+{
+public:
+	WakeupTask(LocalFuture* future):_future(future) {}
+	virtual ~WakeupTask() {}
+	virtual bool run()
 	{
-		conn->remove(promise().sn);//移除连接上的future
-		desc += " " + conn->dump();
+		_future->wakeup();
+		return false;
 	}
+	virtual const char* name() {return "wakeupLocalFuture";}
+private:
+	LocalFuturevar _future;
+};
+}
+
+LocalFuture::LocalFuture(const int ms)
+:_waiting(false)
+,_tms(ms)
+,_caller(lin_io::Coroutine::running())
+{
+}
 
-	GLWARN << "sync future sn: " << promise().sn << " timeout for " << this->_tms << " ms";
-	//设置超时返回
-	this->set_exception(RuntimeException(RpcException::TIMEOUT, desc));
+LocalFuture::~LocalFuture()
+{
 }
 
-void Future::done()
+long LocalFuture::tick()
 {
-	_timer.stop();
-	resume();
+	if(!_deadline)
+		_deadline = lin_io::nowUs()/1000 + _tms;
+	return _tms;
+}
+
+void LocalFuture::wait() throw_exceptions
+{
+	if(!_caller || lin_io::Coroutine::running() != _caller)
+	{
+		GLERROR << "local future sn: " << promise().get_sn() << " must wait in the calling coroutine";
+		throw RuntimeException(RpcException::APP_ERR_CODE);
+	}
+
+	if(!promise().done)
+	{
+		//挂起前提交暂存的任务, 批量作用域要到协程恢复后才结束
+		Scheduler::instance().flush();
+		_waiting = true;
+		lin_io::Coroutine::yield();
+		_waiting = false;
+	}
+
+	if(promise().ex.getCode())
+	{
+		throw promise().ex;
+	}
+}
+
+void LocalFuture::wakeup()
+{
+	if(!_waiting)
+		return;
+	_waiting = false;
+	lin_io::Coroutine::resume(_caller);
+}
+
+void LocalFuture::done()
+{
+	if(!_waiting)
+		return;
+
+	//只能在主协程中切换; 在其他协程中收到响应时投递到本线程稍后唤醒
+	if(!lin_io::Coroutine::running())
+	{
+		wakeup();
+		return;
+	}
+	if(!Scheduler::instance().scheduleConnection(promise().connid, new WakeupTask(this), PRIORITY_URGENT))
+	{
+		GLERROR << "local future sn: " << promise().get_sn() << " wakeup failed, " << Scheduler::lastError();
+	}
 }
 
 //------------------
 AsyncFuture::AsyncFuture(const int tm, Task* cb)
-:_enable(false)
-,_t0(lin_io::nowUs()/1000)
+:_t0(lin_io::nowUs()/1000)
 ,_tms(tm)
-,_timer(this, &AsyncFuture::timeout)
 ,_callback(cb)
+,_context(CallContext::current())
 {
 }
 
@@ -142,13 +211,10 @@ long AsyncFuture::tick()
 	if (now>_t0)
 		_tms -= (now-_t0);
 
-	GLINFO << "async future sn: " << promise().sn << " connid: " << promise().connid << " start timer for " << _tms << " ms";
-	if(!_enable)
-	{
-		if (_tms > 0)
-			_timer.start(_tms);
-		_enable = true;
-	}
+	_t0 = now;
+	_deadline = now + _tms;
+
+	GLINFO << "async future sn: " << promise().get_sn() << " connid: " << promise().connid << " wait for " << _tms << " ms";
 	return _tms;
 }
 
@@ -157,7 +223,7 @@ bool AsyncFuture::setup(Task* c)
 	//生成IO任务
 	if(promise().connid)
 	{
-		return Scheduler::instance().schedule(promise().connid, c);
+		return Scheduler::instance().scheduleConnection(promise().connid, c);
 	}
 
 	GLERROR << "no set connection id";
@@ -169,34 +235,19 @@ void AsyncFuture::done()
 {
 	try
 	{
-		_timer.stop();
+		//回调中的嵌套调用继承原调用链的截止时间
+		CallContext::Scope scope(_context);
 		if(_callback)
 			_callback->run();
 	}
 	catch(std::exception& e)
 	{
-		GLERROR << "async future sn: " << promise().sn << " connid: " << promise().connid << " callback happen error: " << e.what();
+		GLERROR << "async future sn: " << promise().get_sn() << " connid: " << promise().connid << " callback happen error: " << e.what();
 	}
 	catch(...)
 	{
-		GLERROR << "async future sn: " << promise().sn << " connid: " << promise().connid << " callback happen error";
+		GLERROR << "async future sn: " << promise().get_sn() << " connid: " << promise().connid << " callback happen error";
 	}
 }
 
-void AsyncFuture::timeout()
-{
-	lin_io::RcVar<AsyncFuture> ref(this);
-	std::string desc("timeout");
-	Connection* conn = dynamic_cast<Connection*>(Manager::get()->getConnection(promise().connid));
-	if(conn)
-	{
-		conn->remove(promise().sn);//移除连接上的future
-		desc += " " + conn->dump();
-	}
-
-	GLWARN << "async future sn: " << promise().sn << " connid: " << promise().connid << " timeout for " << _tms << " ms " << desc;
-	//设置超时返回
-	this->set_exception(RuntimeException(RpcException::TIMEOUT, desc));
-}
-
 }
@@ -3,6 +3,8 @@
 
 #include <vector>
 #include <string>
+#include <new>
+#include <atomic>
 
 #include "utils/rc.h"
 #include "utils/mutex.h"
@@ -13,6 +15,8 @@
 #include "coroutine.h"
 #include "worker.h"
 #include "handler.h"
+#include "waiter.h"
+#include "call_context.h"
 
 namespace net
 {
@@ -66,36 +70,23 @@ struct Cond
 	virtual bool resume() = 0;
 };
 
+//线程间等待: futex实现, 短暂自旋后休眠
 struct ConditionWrapper : public Cond
 {
 public:
-	ConditionWrapper():_status(wait) {}
+	ConditionWrapper() {}
 	virtual ~ConditionWrapper() {}
 
-	virtual void init() {_status=wait;}
+	virtual void init() {_waiter.reset();}
 
-	virtual void yield()
-	{
-		lin_io::ScopLock<lin_io::Condition> sync(_cond);
-		while(_status == wait)
-		{
-			_cond.wait();
-		}
-	}
+	//等待前提交当前线程暂存的任务(见Scheduler::BatchScope), 否则等待的IO任务不会投递
+	virtual void yield();
 	virtual bool resume()
 	{
-		lin_io::ScopLock<lin_io::Condition> sync(_cond);
-		if(_status != wait)
-		{
-			return false;
-		}
-		_status = ready;
-		_cond.notify();
-		return true ;
+		return _waiter.wake();
 	}
 private:
-	lin_io::Condition _cond;
-	status 	        _status;
+	Waiter _waiter;
 };
 
 struct CoroutineWrapper : public Cond
@@ -128,6 +119,27 @@ private:
 	status		     _status;
 };
 
+//请求序号: 整数序号在连接上走整数表(不分配内存), 字符串序号兼容旧接口
+struct SeqNo
+{
+	SeqNo():num(0),numeric(false) {}
+	SeqNo(const int n):num((uint64_t)n),numeric(true) {}
+	SeqNo(const unsigned int n):num(n),numeric(true) {}
+	SeqNo(const long n):num((uint64_t)n),numeric(true) {}
+	SeqNo(const unsigned long n):num(n),numeric(true) {}
+	SeqNo(const long long n):num((uint64_t)n),numeric(true) {}
+	SeqNo(const unsigned long long n):num(n),numeric(true) {}
+	SeqNo(const std::string& s):num(0),numeric(false),str(s) {}
+	SeqNo(const char* s):num(0),numeric(false),str(s ? s : "") {}
+
+	bool empty() const {return !numeric && str.empty();}
+	std::string toString() const {return numeric ? std::to_string(num) : str;}
+
+	uint64_t    num;
+	bool        numeric;
+	std::string str;
+};
+
 struct Promise
 {
 	class Response
@@ -169,7 +181,7 @@ struct Promise
 	};
 
 public:
-	Promise():val(0),code(0),ex(0),connid(0),done(false) {}
+	Promise():val(0),code(0),ex(0),connid(0),seq(0),numeric(false),done(false) {}
 	virtual ~Promise()
 	{
 		if(val) {delete val;}
@@ -198,13 +210,25 @@ public:
 	}
 
 public:
-	Promise& set_sn(const uint64_t sn) {return set_sn(std::to_string(sn));}
-	Promise& set_sn(const uint32_t sn) {return set_sn(std::to_string(sn));}
+	Promise& set_sn(const uint64_t sn)
+	{
+		this->seq = sn;
+		this->numeric = true;
+		return *this;
+	}
+	Promise& set_sn(const uint32_t sn) {return set_sn((uint64_t)sn);}
 	Promise& set_sn(const std::string& sn)
 	{
 		this->sn = sn;
+		this->numeric = false;
 		return *this;
 	}
+	Promise& set_sn(const SeqNo& sn)
+	{
+		return sn.numeric ? set_sn(sn.num) : set_sn(sn.str);
+	}
+	//用于日志
+	std::string get_sn() const {return numeric ? std::to_string(seq) : sn;}
 
 	Promise& set_codec(Response* val)
 	{
@@ -247,6 +271,8 @@ public:
 	RuntimeException  ex;
 	uint32_t          connid;
 	std::string       sn;
+	uint64_t          seq;//整数序号, numeric为true时有效
+	bool              numeric;
 	bool 		      done;
 	std::string       extra;//扩展字段
 };
@@ -254,17 +280,25 @@ public:
 class IFuture : public lin_io::LockedRefCount
 {
 public:
-	IFuture() {}
+	IFuture():_deadline(0) {}
 	virtual ~IFuture() {}
 
 protected:
 	virtual void done() = 0;
 public:
+	//在IO线程开始调用时执行, 返回剩余时间(ms)并更新截止时间
 	virtual long tick() = 0;
+	//截止时间(ms, 与lin_io::nowUs()同一时钟), 0表示不超时; 由所在连接统一检查超时
+	int64_t deadline() const {return _deadline;}
+
+	//连接迁移到其他IO线程后按新连接ID更新
+	virtual void attach(const uint32_t connid) {_promise.set_connection(connid);}
+	//绑定在当前IO线程(协程调用), 所在连接不能迁移
+	virtual bool pinned() const {return false;}
 
 	void set_exception(const RuntimeException& e)
 	{
-		if(!_promise.done);
+		if(!_promise.done)
 		{
 			_promise.set_exception(e);
 			done();
@@ -286,6 +320,8 @@ public:
 		return _promise;
 	}
 
+protected:
+	int64_t _deadline;
 private:
 	Promise _promise;
 };
@@ -294,8 +330,6 @@ typedef lin_io::RcVar<IFuture> IFuturevar;
 class Future : public IFuture
 {
 public:
-	typedef SimpleTimer<Future> Timer;
-
 	Future(const int tm);
 	virtual ~Future();
 	static lin_io::RcVar<Future> create(const int ms)
@@ -307,9 +341,8 @@ public:
 	virtual long tick();
 
 public:
-	bool setup(Task* c);
+	bool setup(Task* c, const TaskPriority priority = PRIORITY_NORMAL);
 	void wait() throw_exceptions;
-	void timeout();
 private:
 	void setCond(Cond *i) {_sync = i;}
 
@@ -319,21 +352,46 @@ protected:
 
 	virtual void done();//在IO线程执行
 private:
-	bool				_enable;
 	int64_t				_t0;
 	int64_t 	        _tms;
-	Timer 				_timer;
 	Task*			    _executor;
+	TaskPriority        _priority;
 	lin_io::VarVar<Cond>  _sync;
 };
 typedef lin_io::RcVar<Future> Futurevar;
 
+//连接所属IO线程上的协程调用: 直接发送后挂起协程, 响应或超时在本线程唤醒, 不经过Scheduler和条件变量
+class LocalFuture : public IFuture
+{
+public:
+	LocalFuture(const int tm);
+	virtual ~LocalFuture();
+	static lin_io::RcVar<LocalFuture> create(const int ms)
+	{
+		return lin_io::RcVar<LocalFuture>(new LocalFuture(ms));
+	}
+
+	virtual long tick();
+	virtual bool pinned() const {return true;}
+
+public:
+	//挂起当前协程直到响应或超时
+	void wait() throw_exceptions;
+	void wakeup();
+
+protected:
+	virtual void done();
+private:
+	bool				_waiting;
+	int64_t 	        _tms;
+	lin_io::Coroutine*  _caller;
+};
+typedef lin_io::RcVar<LocalFuture> LocalFuturevar;
+
 
 class AsyncFuture : public IFuture
 {
 public:
-	typedef SimpleTimer<AsyncFuture> Timer;
-
 	AsyncFuture(const int tm, Task* cb);
 	virtual ~AsyncFuture();
 
@@ -346,8 +404,8 @@ public:
 	class Executor : public Task
 	{
 	public:
-		Executor(const std::string& name, OBJ* obj, void(OBJ::*fun)(const int code, const REQ& req, const RSP& rsp), const REQ& req)
-		:_name(name), _obj(obj), _fun(fun), _req(req),_code(0)
+		Executor(const TaskName& name, OBJ* obj, void(OBJ::*fun)(const int code, const REQ& req, const RSP& rsp), const REQ& req)
+		:_name(name.c_str()), _obj(obj), _fun(fun), _req(req),_code(0)
 	    {
 	    }
 		virtual ~Executor() {}
@@ -356,13 +414,13 @@ public:
 			(_obj->*_fun)(_code, _req, _rsp);
 			return false;
 		}
-		virtual const std::string& name() {return _name;}
+		virtual const char* name() {return _name;}
 
 		REQ& req() {return _req;}
 		RSP& rsp() {return _rsp;}
 		int& code() {return _code;}
 	private:
-		std::string _name;
+		const char* _name;
 		OBJ* _obj;
 		void(OBJ::*_fun)(const int code, const REQ& req, const RSP& rsp);
 		REQ  _req;
@@ -374,8 +432,8 @@ public:
 	class Executor<void,REQ,RSP> : public Task
 	{
 	public:
-		Executor(const std::string& name, void(*fun)(const int code, const REQ& req, const RSP& rsp), const REQ& req)
-		:_name(name), _fun(fun), _req(req),_code(0)
+		Executor(const TaskName& name, void(*fun)(const int code, const REQ& req, const RSP& rsp), const REQ& req)
+		:_name(name.c_str()), _fun(fun), _req(req),_code(0)
 	    {
 	    }
 		virtual ~Executor() {}
@@ -384,13 +442,13 @@ public:
 			(*_fun)(_code, _req, _rsp);
 			return false;
 		}
-		virtual const std::string& name() {return _name;}
+		virtual const char* name() {return _name;}
 
 		REQ& req() {return _req;}
 		RSP& rsp() {return _rsp;}
 		int& code() {return _code;}
 	private:
-		std::string _name;
+		const char* _name;
 		void(*_fun)(const int code, const REQ& req, const RSP& rsp);
 		REQ  _req;
 		RSP  _rsp;
@@ -402,8 +460,8 @@ public:
 	class ExecutorEx : public Task
 	{
 	public:
-		ExecutorEx(const std::string& name, OBJ* obj, void(OBJ::*fun)(const int code, const CTX& ctx, const REQ& req, const RSP& rsp), const CTX& ctx, const REQ& req)
-		:_name(name), _obj(obj), _fun(fun), _req(req), _ctx(ctx), _code(0)
+		ExecutorEx(const TaskName& name, OBJ* obj, void(OBJ::*fun)(const int code, const CTX& ctx, const REQ& req, const RSP& rsp), const CTX& ctx, const REQ& req)
+		:_name(name.c_str()), _obj(obj), _fun(fun), _req(req), _ctx(ctx), _code(0)
 	    {
 	    }
 		virtual ~ExecutorEx() {}
@@ -412,13 +470,13 @@ public:
 			(_obj->*_fun)(_code, _ctx, _req, _rsp);
 			return false;
 		}
-		virtual const std::string& name() {return _name;}
+		virtual const char* name() {return _name;}
 
 		REQ& req() {return _req;}
 		RSP& rsp() {return _rsp;}
 		int& code() {return _code;}
 	private:
-		std::string _name;
+		const char* _name;
 		OBJ* _obj;
 		void(OBJ::*_fun)(const int code, const CTX& ctx, const REQ& req, const RSP& rsp);
 		REQ  _req;
@@ -431,8 +489,8 @@ public:
 	class ExecutorEx<void,CTX,REQ,RSP> : public Task
 	{
 	public:
-		ExecutorEx(const std::string& name, void(*fun)(const int code, const CTX& ctx, const REQ& req, const RSP& rsp), const CTX& ctx, const REQ& req)
-		:_name(name), _fun(fun), _req(req), _ctx(ctx), _code(0)
+		ExecutorEx(const TaskName& name, void(*fun)(const int code, const CTX& ctx, const REQ& req, const RSP& rsp), const CTX& ctx, const REQ& req)
+		:_name(name.c_str()), _fun(fun), _req(req), _ctx(ctx), _code(0)
 	    {
 	    }
 		virtual ~ExecutorEx() {}
@@ -441,13 +499,13 @@ public:
 			(*_fun)(_code, _ctx, _req, _rsp);
 			return false;
 		}
-		virtual const std::string& name() {return _name;}
+		virtual const char* name() {return _name;}
 
 		REQ& req() {return _req;}
 		RSP& rsp() {return _rsp;}
 		int& code() {return _code;}
 	private:
-		std::string _name;
+		const char* _name;
 		void(*_fun)(const int code, const CTX& ctx, const REQ& req, const RSP& rsp);
 		REQ  _req;
 		RSP  _rsp;
@@ -462,14 +520,12 @@ protected:
 
 public:
 	bool setup(Task* c);
-	void timeout();
 
 private:
-	bool		_enable;
 	int64_t		_t0;
 	int64_t 	_tms;
-	Timer 		_timer;
 	Task*		_callback;
+	CallContext _context;//发起调用时的上下文, 回调在其中执行
 };
 
 typedef lin_io::RcVar<AsyncFuture> AsyncFuturevar;
@@ -505,48 +561,75 @@ public:
 		V& _value;
 	};
 
+	//结果只写入一次; 等待方不再需要结果时可以取消, 之后到达的结果丢弃
 	class Promise
 	{
 	public:
-		Promise(ISyncFuture* f): _done(false),_e(0,"success"),_adapter(0),_future(f)
+		enum State
+		{
+			STATE_PENDING = 0,
+			STATE_WRITING = 1,
+			STATE_DONE = 2,
+			STATE_CANCELLED = 3,
+		};
+
+		Promise(ISyncFuture* f): _state(STATE_PENDING),_e(0,"success"),_adapter(0),_owned(true),_future(f)
 		{
 		}
 		virtual ~Promise()
 		{
-			if(_adapter) {delete _adapter;}
+			if(_adapter && _owned) {delete _adapter;}
 		}
 
 		template<class Reply>
 		void set_value(const Reply& val)
 		{
+			if(!begin())
+				return;
 			if(_adapter)
 			{
 				Adapter<Reply> relay(const_cast<Reply&>(val));
 				_adapter->copy(&relay);
 			}
-			if(!_done)
-			{
-				_done = true;
-				_future->done();
-			}
+			end(true);
 		}
 
 		void set_exception(const RuntimeException& e)
 		{
+			if(!begin())
+				return;
 			_e = e;
-			if(!_done)
+			end(false);
+		}
+
+		//等待方调用: 还没有结果时取消, 正在写入时等待写完; 返回true表示已取消
+		bool cancel()
+		{
+			int state = STATE_PENDING;
+			if(_state.compare_exchange_strong(state, STATE_CANCELLED, std::memory_order_acq_rel))
 			{
-				_done = true;
-				_future->done();
+				_e = RuntimeException(RpcException::CANCELLED);
+				return true;
 			}
+			while(_state.load(std::memory_order_acquire) == STATE_WRITING);
+			return false;
 		}
 
 	public:
 		Promise& set_adapter(IAdapter* adapter)
 		{
-			if(_adapter)
+			if(_adapter && _owned)
 				delete _adapter;
 			_adapter = adapter;
+			_owned = true;
+			return *this;
+		}
+		//不接管|adapter|, 由调用方保证生命周期
+		Promise& bind_adapter(IAdapter* adapter)
+		{
+			set_adapter(0);
+			_adapter = adapter;
+			_owned = false;
 			return *this;
 		}
 
@@ -557,83 +640,158 @@ public:
 		void operator=(const Promise&);
 
 	private:
-		bool _done;
+		bool begin()
+		{
+			int state = STATE_PENDING;
+			return _state.compare_exchange_strong(state, STATE_WRITING, std::memory_order_acq_rel);
+		}
+		//先通知再标记完成: 等待方要等写入方不再访问future后才返回
+		void end(const bool success)
+		{
+			_future->done(success);
+			_state.store(STATE_DONE, std::memory_order_release);
+		}
+
+	private:
+		std::atomic<int> _state;
 		RuntimeException _e;
 		IAdapter*    _adapter;
+		bool         _owned;
 		ISyncFuture* _future;
 	};
 
-	virtual void done() = 0;
+	virtual void done(const bool success) = 0;
 	virtual Promise* promise() = 0;
 };
 
+//多个调用一起等待; 结果、promise和适配器放在同一个槽位里, 槽位按块预分配
+//|need| == 0: 等全部完成
+//|need| > 0 : 前|need|个成功即返回(全部结束也返回), 其余未完成的调用被取消, 结果为RpcException::CANCELLED
 template<typename T>
 class SyncFuture : public ISyncFuture
 {
 public:
-	static lin_io::RcVar< SyncFuture<T> > create()
+	enum
 	{
-		lin_io::RcVar<SyncFuture<T>> p(new SyncFuture<T>);
+		DEFAULT_CAPACITY = 8,
+	};
+
+	//|capacity|: 预计的调用数, 超过后按倍数追加新块
+	static lin_io::RcVar< SyncFuture<T> > create(const int capacity = DEFAULT_CAPACITY, const int need = 0)
+	{
+		lin_io::RcVar<SyncFuture<T>> p(new SyncFuture<T>(capacity, need));
 		return p;
 	}
+	//任意一个成功即返回
+	static lin_io::RcVar< SyncFuture<T> > first(const int capacity = 2)
+	{
+		return create(capacity, 1);
+	}
 
 public:
 	const std::vector< std::pair<T,RuntimeException>* >& get()
 	{
 		this->wait();
-		for(int i = 0; i < (int)_promises.size(); i++)
+		for(int i = 0; i < (int)_slots.size(); i++)
 		{
-			_results[i]->second = ((Promise*)_promises[i])->get_exception();
+			_slots[i]->promise.cancel();
+			_slots[i]->result.second = _slots[i]->promise.get_exception();
 		}
 		return _results;
 	}
+	//成功的调用数
+	int succeeded() const {return _succeeded;}
 
-	SyncFuture(): _count(0),_sync(new ConditionWrapper())
+	SyncFuture(const int capacity = DEFAULT_CAPACITY, const int need = 0)
+	: _count(0),_succeeded(0),_need(need),_capacity(capacity > 0 ? capacity : 1),_fill(0),_blockSize(0)
 	{
+		_slots.reserve(_capacity);
+		_results.reserve(_capacity);
+		grow();
 	}
 	virtual ~SyncFuture()
 	{
-		for(auto e : _results) {delete e;}
-		for(auto e : _promises) {delete e;}
+		for(auto e : _slots) {e->~Slot();}
+		for(auto b : _blocks) {::operator delete(b);}
 	}
 
 	Promise* promise()
 	{
-		auto r = new std::pair<T,RuntimeException>();
-		auto p = new Promise(this);
-		_results.push_back(r);//创建结果
-		_promises.push_back(p);//创建promise
-		p->set_adapter(new Adapter<T>(r->first));
+		if(_fill == _blockSize)
+		{
+			grow();
+		}
+		Slot* slot = new(_blocks.back() + _fill++) Slot(this);
+		_slots.push_back(slot);
+		_results.push_back(&slot->result);
 
 		if(1 == lin_io::increment_int32(&_count,1))
 		{
-			_sync->init();
+			_sync.init();
 		}
-		return p;
+		return &slot->promise;
 	}
 
 protected:
-	void done()
+	void done(const bool success)
 	{
+		bool wake = false;
+		if(success && _need > 0 && _need == lin_io::increment_int32(&_succeeded,1))
+		{
+			wake = true;
+		}
+		else if(success && _need == 0)
+		{
+			lin_io::increment_int32(&_succeeded,1);
+		}
 		if(0 == lin_io::increment_int32(&_count,-1))
 		{
-			_sync->resume();
+			wake = true;
+		}
+		if(wake)
+		{
+			_sync.resume();
 		}
 	}
 
 private:
+	struct Slot
+	{
+		Slot(ISyncFuture* f):adapter(result.first),promise(f)
+		{
+			promise.bind_adapter(&adapter);
+		}
+		std::pair<T,RuntimeException> result;
+		Adapter<T> adapter;
+		Promise promise;
+	};
+
+	//块一经分配不再移动, 已返回的promise地址保持有效
+	void grow()
+	{
+		_blockSize = _blocks.empty() ? _capacity : _blockSize * 2;
+		_blocks.push_back(static_cast<Slot*>(::operator new(sizeof(Slot) * _blockSize)));
+		_fill = 0;
+	}
+
 	void wait()
 	{
-		if(_count)
+		if(_count && (_need == 0 || _succeeded < _need))
 		{
-			_sync->yield();
+			_sync.yield();
 		}
 	}
 
 private:
 	volatile int32_t _count;
-	lin_io::VarVar<Cond> _sync;
-	std::vector<Promise*> _promises;
+	volatile int32_t _succeeded;
+	int _need;
+	ConditionWrapper _sync;
+	int _capacity;
+	int _fill;//当前块已使用的槽位数
+	int _blockSize;
+	std::vector<Slot*> _blocks;
+	std::vector<Slot*> _slots;
 	std::vector< std::pair<T, RuntimeException>* > _results;
 };
 typedef lin_io::RcVar<ISyncFuture> ISyncFuturevar;
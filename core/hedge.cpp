@@ -0,0 +1,182 @@
+#include "hedge.h"
+#include "log/logger.h"
+#include "scheduler.h"
+#include "manager.h"
+
+using namespace net;
+
+namespace
+{
+void io_thread_cancel_call(const std::pair<uint32_t,IFuturevar>& call)
+{
+	Connection* conn = dynamic_cast<Connection*>(Manager::get()->getConnection(call.first));
+	if(conn)
+	{
+		conn->cancel(call.second.ptr());
+	}
+}
+}
+
+HedgePolicy::HedgePolicy(const int initialDelayMs, const int percentile, const int maxPercent)
+:_samples(0)
+,_calls(0)
+,_hedges(0)
+,_delay(initialDelayMs)
+,_initialDelay(initialDelayMs)
+,_percentile(percentile)
+,_maxPercent(maxPercent)
+{
+	for(int i = 0; i < BUCKET_COUNT; i++)
+	{
+		_buckets[i].store(0);
+	}
+}
+
+int HedgePolicy::bucketOf(const uint64_t us)
+{
+	if(us < 4)
+		return (int)us;
+	int e = 63 - __builtin_clzll(us);
+	int bucket = (e - 1) * 4 + (int)((us >> (e - 2)) & 3);
+	return bucket < BUCKET_COUNT ? bucket : BUCKET_COUNT - 1;
+}
+
+uint64_t HedgePolicy::upperOf(const int bucket)
+{
+	if(bucket < 4)
+		return bucket + 1;
+	int e = bucket / 4 + 1;
+	return (uint64_t)(4 + bucket % 4 + 1) << (e - 2);
+}
+
+void HedgePolicy::record(const int64_t us)
+{
+	_buckets[bucketOf(us > 0 ? (uint64_t)us : 0)].fetch_add(1, std::memory_order_relaxed);
+	uint32_t samples = _samples.fetch_add(1, std::memory_order_relaxed) + 1;
+	if(samples % UPDATE_INTERVAL == 0)
+	{
+		update();
+	}
+}
+
+void HedgePolicy::update()
+{
+	uint32_t counts[BUCKET_COUNT];
+	uint64_t total = 0;
+	for(int i = 0; i < BUCKET_COUNT; i++)
+	{
+		counts[i] = _buckets[i].load(std::memory_order_relaxed);
+		total += counts[i];
+	}
+	if(total < MIN_SAMPLES)
+		return;
+
+	uint64_t rank = (total * _percentile + 99) / 100;
+	uint64_t seen = 0;
+	for(int i = 0; i < BUCKET_COUNT; i++)
+	{
+		seen += counts[i];
+		if(seen >= rank)
+		{
+			int ms = (int)((upperOf(i) + 999) / 1000);
+			_delay.store(ms > 0 ? ms : 1, std::memory_order_relaxed);
+			break;
+		}
+	}
+
+	//衰减: 并发下少量计数误差可以接受
+	if(total > DECAY_SAMPLES)
+	{
+		for(int i = 0; i < BUCKET_COUNT; i++)
+		{
+			_buckets[i].store(counts[i] / 2, std::memory_order_relaxed);
+		}
+		_calls.store(_calls.load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+		_hedges.store(_hedges.load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+	}
+}
+
+bool HedgePolicy::acquire()
+{
+	uint32_t calls = _calls.load(std::memory_order_relaxed);
+	uint32_t hedges = _hedges.load(std::memory_order_relaxed);
+	if((uint64_t)(hedges + 1) * 100 > (uint64_t)calls * _maxPercent)
+		return false;
+	_hedges.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+//------------------
+void HedgeState::finish(const int leg, const bool success)
+{
+	if(success)
+	{
+		int winner = -1;
+		if(_winner.compare_exchange_strong(winner, leg))
+		{
+			_waiter.wake();
+		}
+		return;
+	}
+	if(_failed.fetch_add(1) + 1 >= _launched.load())
+	{
+		_waiter.wake();
+	}
+}
+
+bool HedgeState::wait(const int ms)
+{
+	const int64_t end = lin_io::nowUs()/1000 + ms;
+	//批量作用域内先提交暂存的IO任务
+	Scheduler::instance().flush();
+	//状态先于唤醒更新: 重置后重新检查, 不会丢失唤醒
+	while(!settled())
+	{
+		if(ms < 0)
+		{
+			_waiter.wait();
+		}
+		else
+		{
+			int64_t left = end - lin_io::nowUs()/1000;
+			if(left <= 0)
+				return false;
+			_waiter.wait_for((int)left);
+		}
+		_waiter.reset();
+	}
+	return true;
+}
+
+void HedgeState::cancel(const uint32_t connid, IFuture* future)
+{
+	IFuturevar ref(future);
+	if(!Scheduler::instance().scheduleConnection(connid, io_thread_cancel_call, std::make_pair(connid, ref), "cancelCall", PRIORITY_URGENT))
+	{
+		GLWARN << "cancel call connid: " << connid << " sn: " << future->promise().get_sn() << " failed, " << Scheduler::lastError();
+	}
+}
+
+//------------------
+HedgeFuture::HedgeFuture(HedgeState* state, const int leg, const int ms)
+:_state(state)
+,_leg(leg)
+,_t0(lin_io::nowUs()/1000)
+,_tms(ms)
+{
+}
+
+long HedgeFuture::tick()
+{
+	int64_t now(lin_io::nowUs()/1000);//ms
+	if (now>_t0)
+		_tms -= (now-_t0);
+	_t0 = now;
+	_deadline = now + _tms;
+	return _tms;
+}
+
+void HedgeFuture::done()
+{
+	_state->finish(_leg, promise().ex.getCode() == 0);
+}
@@ -0,0 +1,111 @@
+#ifndef __NET_HEDGE_H__
+#define __NET_HEDGE_H__
+
+#include <atomic>
+#include "future.h"
+#include "waiter.h"
+
+namespace net
+{
+//对冲调用策略: 统计成功调用的时延分位数, 主调用超过该时延还没有成功时向备用连接再发一次
+//对冲次数不超过调用数的|maxPercent|%, 后端整体变慢时不会把负载翻倍
+//时延按对数分桶(每个2的幂再分4档)统计, 样本数超过DECAY_SAMPLES时减半, 跟随近期分布
+class HedgePolicy
+{
+public:
+	enum
+	{
+		BUCKET_COUNT = 96,     //最大约30秒
+		MIN_SAMPLES = 32,      //样本不足时使用初始延时
+		UPDATE_INTERVAL = 64,  //每隔多少个样本重新计算分位数
+		DECAY_SAMPLES = 8192,
+	};
+
+	HedgePolicy(const int initialDelayMs = 10, const int percentile = 95, const int maxPercent = 10);
+
+	//成功调用的时延(微秒)
+	void record(const int64_t us);
+	//对冲延时(毫秒)
+	int delay() const {return _delay.load(std::memory_order_relaxed);}
+	//发起一次调用
+	void count() {_calls.fetch_add(1, std::memory_order_relaxed);}
+	//申请一次对冲, 超过比例时返回false
+	bool acquire();
+
+private:
+	static int bucketOf(const uint64_t us);
+	static uint64_t upperOf(const int bucket);
+	void update();
+
+private:
+	std::atomic<uint32_t> _buckets[BUCKET_COUNT];
+	std::atomic<uint32_t> _samples;
+	std::atomic<uint32_t> _calls;
+	std::atomic<uint32_t> _hedges;
+	std::atomic<int> _delay;
+	const int _initialDelay;
+	const int _percentile;
+	const int _maxPercent;
+};
+
+//一次对冲调用的共享状态: 第一个成功的调用胜出, 全部失败时结束
+class HedgeState : public lin_io::LockedRefCount
+{
+public:
+	enum
+	{
+		MAX_LEGS = 2,
+	};
+
+	HedgeState():_winner(-1),_launched(0),_failed(0) {}
+	virtual ~HedgeState() {}
+
+	void launch() {_launched.fetch_add(1);}
+	//调用结束, 在IO线程执行
+	void finish(const int leg, const bool success);
+
+	int winner() const {return _winner.load();}
+	bool settled() const {return _winner.load() >= 0 || _failed.load() >= _launched.load();}
+	//等待结束, |ms| < 0时一直等待; 超时返回false
+	bool wait(const int ms);
+
+	//在|connid|所属IO线程上撤销没有胜出的调用, 之后到达的响应被丢弃
+	static void cancel(const uint32_t connid, IFuture* future);
+
+private:
+	std::atomic<int> _winner;
+	std::atomic<int> _launched;
+	std::atomic<int> _failed;
+	Waiter _waiter;
+};
+
+template<typename Reply>
+class HedgeCall : public HedgeState
+{
+public:
+	virtual ~HedgeCall() {}
+	Reply& reply(const int leg) {return _replies[leg];}
+private:
+	Reply _replies[MAX_LEGS];//每个调用单独写, 避免两个IO线程同时写调用方的响应
+};
+
+//对冲调用中的一个调用
+class HedgeFuture : public IFuture
+{
+public:
+	HedgeFuture(HedgeState* state, const int leg, const int ms);
+	virtual ~HedgeFuture() {}
+
+	virtual long tick();
+protected:
+	virtual void done();
+private:
+	lin_io::RcVar<HedgeState> _state;
+	int _leg;
+	int64_t _t0;
+	int64_t _tms;
+};
+typedef lin_io::RcVar<HedgeFuture> HedgeFuturevar;
+}
+
+#endif
@@ -10,17 +10,22 @@
 #include "utils/exception.h"
 #include "log/logger.h"
 #include "future.h"
+#include "hedge.h"
+#include "call_context.h"
+#include "batch.h"
 #include "manager.h"
 #include "scheduler.h"
 
 namespace net
 {
-//注意:接口类不能在当前IO线程中调用
+//注意:接口类不能在当前IO线程中调用; call例外, 在连接所属IO线程的协程中调用时直接发送并挂起协程
 /*接口列表:
  * -------------------------------
  *get         同步获取连接信息
  *async_get   异步获取连接信息
  *call        发送数据同频等待响应
+ *hedged_call 发送数据同步等待响应, 慢时向备用连接再发一次, 取最先成功的响应
+ *batch       同一连接上的多个请求一次发送, 同步等待全部响应
  *async_call  发送数据异步等待响应
  *oneway      发送数据没有响应
  *close       同步关闭连接
@@ -121,8 +126,8 @@ public:
 	class Executor : public Task
 	{
 	public:
-		Executor(const std::string& name, const uint32_t connid, Function* fun, IFuture* future=NULL)
-		:_name(name),_connid(connid),_method(fun),_future(future)
+		Executor(const TaskName& name, const uint32_t connid, Function* fun, IFuture* future=NULL)
+		:_name(name.c_str()),_connid(connid),_method(fun),_future(future)
 		{
 		}
 		virtual ~Executor() {delete _method;}
@@ -143,10 +148,10 @@ public:
 			}
 			return false;
 		}
-		virtual const string& name() {return _name;}
+		virtual const char* name() {return _name;}
 
 	private:
-		std::string _name;
+		const char* _name;
 		uint32_t    _connid;
 		Function*   _method;
 		IFuturevar 	_future;
@@ -167,6 +172,101 @@ public:
 		return true;
 	}
 
+	//对冲调用: 先发到本连接, 超过policy.delay()还没有成功响应(或已经失败)时再发到|backup|连接,
+	//返回最先成功的响应, 另一个调用被撤销; 两个连接上的序号都用|sn|
+	template<typename Request,typename Reply>
+	bool hedged_call(const uint32_t backup, HedgePolicy& policy, const SeqNo& sn, const Request& req, Reply& rsp, const int ms=1000) throw_exceptions
+	{
+		const int tmo = budget(ms);
+		GLINFO << "connid: " << _connid << " backup: " << backup << " hedged wait timeout(ms): " << tmo << " delay(ms): " << policy.delay();
+		if(tmo <= 0)
+		{
+			throw RuntimeException(RpcException::TIMEOUT, "deadline exceeded before call");
+		}
+
+		//两个连接共享同一份序列化数据
+		SendBuffervar buffer(encode(req));
+		lin_io::RcVar< HedgeCall<Reply> > state(new HedgeCall<Reply>());
+		const uint32_t connids[HedgeState::MAX_LEGS] = {_connid, backup};
+		int64_t starts[HedgeState::MAX_LEGS] = {lin_io::nowUs(), 0};
+		IFuturevar legs[HedgeState::MAX_LEGS];
+
+		policy.count();
+		legs[0] = hedge_launch<Reply>(state, 0, connids[0], sn, buffer.ptr(), tmo);
+		if(!state->wait(policy.delay()) || state->winner() < 0)
+		{
+			int left = tmo - (int)((lin_io::nowUs() - starts[0])/1000);
+			if(backup && backup != _connid && left > 0 && policy.acquire())
+			{
+				starts[1] = lin_io::nowUs();
+				legs[1] = hedge_launch<Reply>(state, 1, connids[1], sn, buffer.ptr(), left);
+			}
+		}
+		state->wait(-1);
+
+		const int winner = state->winner();
+		if(winner < 0)
+		{
+			//都失败, 返回最后一个调用的错误
+			int last = legs[1].ptr() ? 1 : 0;
+			throw legs[last]->promise().ex;
+		}
+		for(int i = 0; i < HedgeState::MAX_LEGS; i++)
+		{
+			if(i != winner && legs[i].ptr())
+			{
+				HedgeState::cancel(connids[i], legs[i].ptr());
+			}
+		}
+		policy.record(lin_io::nowUs() - starts[winner]);
+		rsp = state->reply(winner);
+		return true;
+	}
+
+	template<typename Reply>
+	IFuturevar hedge_launch(lin_io::RcVar< HedgeCall<Reply> >& state, const int leg, const uint32_t connid, const SeqNo& sn, SendBuffer* buffer, const int ms)
+	{
+		HedgeFuturevar future(new HedgeFuture(state.ptr(), leg, ms));
+		future->promise().set_sn(sn).set_connection(connid).set_codec(new Promise::VariedResponse<Reply>(state->reply(leg)));
+		state->launch();
+		if(!Scheduler::instance().scheduleConnection(connid, new Transport("hedged_call", connid, buffer, sn, future.ptr())))
+		{
+			future->set_exception(RuntimeException(RpcException::WORKER_QUEUE_FULL));
+		}
+		return IFuturevar(future.ptr());
+	}
+
+	//在所属IO线程的协程中: 序列化、发送、挂起, 响应到达时在本线程唤醒
+	template<typename Request,typename Reply>
+	bool local_call(const SeqNo& sn, const Request& req, Reply& rsp, const int ms) throw_exceptions
+	{
+		Connection* conn = dynamic_cast<Connection*>(Manager::get()->getConnection(_connid));
+		if(!conn)
+		{
+			GLWARN << "connid:" << _connid << " closed";
+			throw RuntimeException(RpcException::CONNECTION_CLOSED);
+		}
+
+		SendBuffervar buffer(encode(req));
+		if(!buffer.ptr())
+		{
+			GLWARN << "connid:" << _connid << " serialize failed";
+			throw RuntimeException(RpcException::PROTOCOL_ERROR);
+		}
+
+		LocalFuturevar future = LocalFuture::create(ms);
+		future->promise().set_sn(sn).set_connection(_connid).set_codec(new Promise::VariedResponse<Reply>(rsp));
+		conn->send(buffer.ptr());
+		future->tick();
+		if(sn.numeric)
+			conn->push(sn.num, future.ptr());
+		else
+			conn->push(sn.str, future.ptr());
+		future->wait();
+
+		return true;
+	}
+
 	template<typename Object,typename Reply>
 	bool get(Reply& rsp, Object* obj, void(Object::*fun)(IConnection* conn, Reply& rsp), const int ms=1000)
 	{
@@ -189,7 +289,7 @@ public:
 		AsyncCallback* cb = new AsyncCallback(fun, ctx);
 
 		Executor* task = new Executor("async_get", _connid, cb);
-		return Scheduler::instance().schedule(_connid, task);
+		return Scheduler::instance().scheduleConnection(_connid, task);
 	}
 
 	template<typename Object,typename Context>
@@ -199,16 +299,35 @@ public:
 		AsyncCallback* cb = new AsyncCallback(obj, fun, ctx);
 
 		Executor* task = new Executor("async_get", _connid, cb);
-		return Scheduler::instance().schedule(_connid, task);
+		return Scheduler::instance().scheduleConnection(_connid, task);
 	}
 
-	//transport
+	//序列化在调用线程完成, 失败时返回空, 由IO任务按PROTOCOL_ERROR返回给future
 	template<typename Request>
+	SendBuffer* encode(const Request& req)
+	{
+		SendBuffer* buffer = new SendBuffer();
+		try
+		{
+			lin_io::Pack pack(&buffer->buffer());
+			if(req.serialize(pack))
+				return buffer;
+		}
+		catch(std::exception& e)
+		{
+			GLWARN << "connid:" << _connid << " serialize exception: " << e.what();
+		}
+		delete buffer;
+		return 0;
+	}
+
+	//transport: IO线程只把已序列化的数据挂到连接上
 	class Transport : public Task
 	{
 	public:
-		Transport(const std::string& name, const uint32_t connid, const Request& request, const string& sn="", IFuture* future=0)
-		:_name(name), _connid(connid), _request(request), _sn(sn), _future(future)
+		Transport(const TaskName& name, const uint32_t connid, SendBuffer* buffer, const SeqNo& sn=SeqNo(), IFuture* future=0)
+		:_name(name.c_str()), _connid(connid), _buffer(buffer), _sn(sn), _future(future)
+		, _deadline(CallContext::current().deadline())
 		{
 		}
 		virtual ~Transport() {}
@@ -236,7 +355,7 @@ public:
 
 			return false;
 		}
-		virtual const string& name() {return _name;}
+		virtual const char* name() {return _name;}
 
 	private:
 		void execute()
@@ -246,10 +365,16 @@ public:
 			if(_future.ptr()) tmo = _future->tick();//启动定时器
 			if(_future.ptr() && (tmo <= 0))
 			{
-				GLWARN << "connid " << _connid << " io busy";
+				GLWARN << "connid " << _connid << " expired in queue, skip sending";
 				throw RuntimeException(RpcException::IO_BUSY);
 				return;
 			}
+			//没有响应的请求按调用上下文的截止时间丢弃
+			if(!_future.ptr() && _deadline > 0 && lin_io::nowUs()/1000 >= _deadline)
+			{
+				GLWARN << "connid " << _connid << " " << _name << " expired in queue, skip sending";
+				return;
+			}
 			Connection* conn = dynamic_cast<Connection*>(Manager::get()->getConnection(_connid));
 			if(!conn)
 			{
@@ -258,40 +383,52 @@ public:
 				return;
 			}
 
-			//序列化并发送数据
-			lin_io::Pack pack;
-			if(!_request.serialize(pack))
+			//发送调用线程序列化好的数据
+			if(!_buffer.ptr())
 			{
-				GLWARN << "connid:" << _connid << " closed";
+				GLWARN << "connid:" << _connid << " serialize failed";
 				throw RuntimeException(RpcException::PROTOCOL_ERROR);
 				return;
 			}
-			conn->send(pack.data(), (uint32_t)pack.size());
+			conn->send(_buffer.ptr());
 
 			//把future放在连接中
 			if(_future.ptr())
 			{
-				conn->push(_sn, _future);
+				if(_sn.numeric)
+					conn->push(_sn.num, _future);
+				else
+					conn->push(_sn.str, _future);
 			}
 		}
 	private:
-		std::string	_name;
+		const char*	_name;
 		uint32_t	_connid;
-		Request     _request;
-		string      _sn;
+		SendBuffervar _buffer;
+		SeqNo       _sn;
 		IFuturevar 	_future;
+		int64_t     _deadline;//调用上下文的截止时间, 0表示没有
 	};
 
 	//------------------------------------------------------------------------------------------------------------
 	//发送数据，同步响应
 	template<typename Request,typename Reply>
-	bool call(const string& sn, const Request& req, Reply& rsp, const int ms=1000) throw_exceptions
+	bool call(const SeqNo& sn, const Request& req, Reply& rsp, const int ms=1000) throw_exceptions
 	{
-		GLINFO << "connid: " << _connid << " sync wait timeout(ms): " << ms;
+		const int tmo = budget(ms);
+		GLINFO << "connid: " << _connid << " sync wait timeout(ms): " << tmo;
+		if(tmo <= 0)
+		{
+			throw RuntimeException(RpcException::TIMEOUT, "deadline exceeded before call");
+		}
+		if(lin_io::Coroutine::running() && Scheduler::instance().isOwnerThread(_connid))
+		{
+			return local_call(sn, req, rsp, tmo);
+		}
 
-		Futurevar future = Future::create(ms);
+		Futurevar future = Future::create(tmo);
 		future->promise().set_sn(sn).set_connection(_connid).set_codec(new Promise::VariedResponse<Reply>(rsp));
-		future->setup(new Transport<Request>("call", _connid, req, sn, future.ptr()));
+		future->setup(new Transport("call", _connid, encode(req), sn, future.ptr()));
 		future->wait();
 
 		return true;
@@ -299,7 +436,7 @@ public:
 
 	//发送数据，异步响应
 	template<typename Request,typename Reply>
-	bool async_call(const string& sn, const Request& req,
+	bool async_call(const SeqNo& sn, const Request& req,
 			void(*fun)(const int, const Request&, const Reply&), const uint32_t ms=1000) throw_exceptions
 	{
 		//必须要有SN
@@ -308,20 +445,26 @@ public:
 			GLERROR << "connid: " << _connid << " sn is empty";
 			return false;
 		}
-		GLINFO << "connid: " << _connid << " sn: " << sn << " async wait timeout(ms): " << ms;
+		const int tmo = budget(ms);
+		if(tmo <= 0)
+		{
+			GLWARN << "connid: " << _connid << " sn: " << sn.toString() << " deadline exceeded before call";
+			return false;
+		}
+		GLINFO << "connid: " << _connid << " sn: " << sn.toString() << " async wait timeout(ms): " << tmo;
 
 		//构建回调执行者
 		typedef AsyncFuture::Executor<void,Request,Reply> AsyncCallback;
 		AsyncCallback* cb = new AsyncCallback("", fun, req);
 
 		//创建异步future
-		AsyncFuturevar future = AsyncFuture::create(ms, cb);
+		AsyncFuturevar future = AsyncFuture::create(tmo, cb);
 		future->promise().set_sn(sn).set_connection(_connid).set_codec(new Promise::VariedResponse<Reply>(cb->rsp())).set_codec(new net::Promise::StatusCode(cb->code()));
-		return future->setup(new Transport<Request>("async_call", _connid, req, sn, future.ptr()));
+		return future->setup(new Transport("async_call", _connid, encode(req), sn, future.ptr()));
 	}
 
 	template<typename Object,typename Request,typename Reply>
-	bool async_call(const string& sn, const Request& req,Object* obj,
+	bool async_call(const SeqNo& sn, const Request& req,Object* obj,
 			void(Object::*fun)(const int, const Request&, const Reply&), const uint32_t ms=1000) throw_exceptions
 	{
 		//必须要有SN
@@ -330,21 +473,27 @@ public:
 			GLERROR << "connid: " << _connid << " sn is empty";
 			return false;
 		}
-		GLINFO << "connid: " << _connid << " sn: " << sn << " async wait timeout(ms): " << ms;
+		const int tmo = budget(ms);
+		if(tmo <= 0)
+		{
+			GLWARN << "connid: " << _connid << " sn: " << sn.toString() << " deadline exceeded before call";
+			return false;
+		}
+		GLINFO << "connid: " << _connid << " sn: " << sn.toString() << " async wait timeout(ms): " << tmo;
 
 		//构建回调执行者
 		typedef AsyncFuture::Executor<Object,Request,Reply> AsyncCallback;
 		AsyncCallback* cb = new AsyncCallback("", obj, fun, req);
 
 		//创建异步future
-		AsyncFuturevar future = AsyncFuture::create(ms, cb);
+		AsyncFuturevar future = AsyncFuture::create(tmo, cb);
 		future->promise().set_sn(sn).set_connection(_connid).set_codec(new Promise::VariedResponse<Reply>(cb->rsp())).set_codec(new net::Promise::StatusCode(cb->code()));
-		return future->setup(new Transport<Request>("async_call", _connid, req, sn, future.ptr()));
+		return future->setup(new Transport("async_call", _connid, encode(req), sn, future.ptr()));
 	}
 
 	//发送数据，异步响应
 	template<typename Request,typename Reply,typename Extra>
-	bool async_call(const std::string& sn, const Extra& ext, const Request& req,
+	bool async_call(const SeqNo& sn, const Extra& ext, const Request& req,
 			void(*fun)(const int, const Extra&, const Request&, const Reply&), const int ms=1000) throw_exceptions
 	{
 		//必须要有SN
@@ -353,20 +502,26 @@ public:
 			GLERROR << "connid: " << _connid << " sn is empty";
 			return false;
 		}
-		GLINFO << "connid: " << _connid << " sn: " << sn << " async wait timeout(ms): " << ms;
+		const int tmo = budget(ms);
+		if(tmo <= 0)
+		{
+			GLWARN << "connid: " << _connid << " sn: " << sn.toString() << " deadline exceeded before call";
+			return false;
+		}
+		GLINFO << "connid: " << _connid << " sn: " << sn.toString() << " async wait timeout(ms): " << tmo;
 
 		//构建回调执行者
 		typedef AsyncFuture::ExecutorEx<void,Extra,Request,Reply> AsyncCallback;
 		AsyncCallback* cb = new AsyncCallback("", fun, ext, req);
 
 		//创建异步future
-		AsyncFuturevar future = AsyncFuture::create(ms, cb);
+		AsyncFuturevar future = AsyncFuture::create(tmo, cb);
 		future->promise().set_sn(sn).set_connection(_connid).set_codec(new Promise::VariedResponse<Reply>(cb->rsp())).set_codec(new net::Promise::StatusCode(cb->code()));
-		return future->setup(new Transport<Request>("async_call", _connid, req, sn, future.ptr()));
+		return future->setup(new Transport("async_call", _connid, encode(req), sn, future.ptr()));
 	}
 
 	template<typename Object,typename Request,typename Reply,typename Extra>
-	bool async_call(const std::string& sn, const Extra& ext, const Request& req, Object* obj,
+	bool async_call(const SeqNo& sn, const Extra& ext, const Request& req, Object* obj,
 			void(*fun)(const int, const Extra&, const Request&, const Reply&), const int ms=1000) throw_exceptions
 	{
 		//必须要有SN
@@ -375,34 +530,46 @@ public:
 			GLERROR << "connid: " << _connid << " sn is empty";
 			return false;
 		}
-		GLINFO << "connid: " << _connid << " sn: " << sn << " async wait timeout(ms): " << ms;
+		const int tmo = budget(ms);
+		if(tmo <= 0)
+		{
+			GLWARN << "connid: " << _connid << " sn: " << sn.toString() << " deadline exceeded before call";
+			return false;
+		}
+		GLINFO << "connid: " << _connid << " sn: " << sn.toString() << " async wait timeout(ms): " << tmo;
 
 		//构建回调执行者
 		typedef AsyncFuture::ExecutorEx<Object,Extra,Request,Reply> AsyncCallback;
 		AsyncCallback* cb = new AsyncCallback("", obj, fun, ext, req);
 
 		//创建异步future
-		AsyncFuturevar future = AsyncFuture::create(ms, cb);
+		AsyncFuturevar future = AsyncFuture::create(tmo, cb);
 		future->promise().set_sn(sn).set_connection(_connid).set_codec(new Promise::VariedResponse<Reply>(cb->rsp())).set_codec(new net::Promise::StatusCode(cb->code()));
-		return future->setup(new Transport<Request>("async_call", _connid, req, sn, future.ptr()));
+		return future->setup(new Transport("async_call", _connid, encode(req), sn, future.ptr()));
+	}
+
+	//批量调用: 收集多个请求后一次发送, 见Batch
+	Batch batch()
+	{
+		return Batch(_connid);
 	}
 
 	//发送数据，没有响应
 	template<typename Request>
 	bool oneway(Request& req) throw_exceptions
 	{
-		Transport<Request>* task = new Transport<Request>("oneway", _connid, req);
+		Transport* task = new Transport("oneway", _connid, encode(req));
 
 		//生成IO任务
-		return Scheduler::instance().schedule(_connid, task);
+		return Scheduler::instance().scheduleConnection(_connid, task);
 	}
 
 	//-----------------------------------------------------------------------------------------------------------------
 	class Closer : public Task
 	{
 	public:
-		Closer(const std::string& name, const uint32_t connid, IFuture* future=NULL)
-		:_name(name),_connid(connid),_future(future)
+		Closer(const TaskName& name, const uint32_t connid, IFuture* future=NULL)
+		:_name(name.c_str()),_connid(connid),_future(future)
 		{
 		}
 		virtual ~Closer() {}
@@ -422,10 +589,10 @@ public:
 			}
 			return false;
 		}
-		virtual const string& name() {return _name;}
+		virtual const char* name() {return _name;}
 
 	private:
-		std::string _name;
+		const char* _name;
 		uint32_t    _connid;
 		IFuturevar 	_future;
 	};
@@ -435,7 +602,7 @@ public:
 	{
 		Futurevar future = Future::create(ms);
 		future->promise().set_connection(_connid);
-		future->setup(new Closer("close", _connid, future.ptr()));
+		future->setup(new Closer("close", _connid, future.ptr()), PRIORITY_URGENT);
 		future->wait();
 		return true;
 	}
@@ -448,7 +615,7 @@ public:
 
 		Futurevar future = Future::create(ms);
 		future->promise().set_connection(_connid);
-		future->setup(new Closer("close", _connid, cb, future.ptr()));
+		future->setup(new Closer("close", _connid, cb, future.ptr()), PRIORITY_URGENT);
 		future->wait();
 
 		return true;
@@ -462,7 +629,7 @@ public:
 
 		Futurevar future = Future::create(ms);
 		future->promise().set_connection(_connid);
-		future->setup(new Closer("close", _connid, cb, future.ptr()));
+		future->setup(new Closer("close", _connid, cb, future.ptr()), PRIORITY_URGENT);
 		future->wait();
 
 		return true;
@@ -472,7 +639,7 @@ public:
 	bool async_close()
 	{
 		Closer* task = new Closer("async_close", _connid);
-		return Scheduler::instance().schedule(_connid, task);
+		return Scheduler::instance().scheduleConnection(_connid, task, PRIORITY_URGENT);
 	}
 
 	template<typename Context>
@@ -482,7 +649,7 @@ public:
 		AsyncCallback* cb = new AsyncCallback(fun, ctx);
 
 		Closer* task = new Closer("async_close", _connid, cb);
-		return Scheduler::instance().schedule(_connid, task);
+		return Scheduler::instance().scheduleConnection(_connid, task, PRIORITY_URGENT);
 	}
 
 	template<typename Object,typename Context>
@@ -492,7 +659,14 @@ public:
 		AsyncCallback* cb = new AsyncCallback(obj, fun, ctx);
 
 		Closer* task = new Closer("async_close", _connid, cb);
-		return Scheduler::instance().schedule(_connid, task);
+		return Scheduler::instance().scheduleConnection(_connid, task, PRIORITY_URGENT);
+	}
+
+private:
+	//按当前调用上下文缩短超时, 已过期返回0
+	static int budget(const int ms)
+	{
+		return CallContext::current().clamp(ms);
 	}
 
 private:
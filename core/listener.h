@@ -74,6 +74,9 @@ struct IServerContext : public lin_io::LockedRefCount
 	//接受的连接的线程调度
 	bool shareThread = false;//共享服务端口监听的线程
     std::shared_ptr<uint32_t> hashKey;
+
+    //UDP可靠传输配置, 为空不开启
+    std::shared_ptr<ArqConfig> arq;
 };
 
 typedef lin_io::RcVar<IServerContext> IServerContext_var;
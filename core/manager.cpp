@@ -1,14 +1,29 @@
 #include "manager.h"
 #include <sstream>
+#include <algorithm>
 #include "log/logger.h"
+#include "common.h"
 #include "tcp_connection.h"
 #include "tcp_client.h"
 #include "udp_connection.h"
 #include "udp_client.h"
+#include "scheduler.h"
 
 using namespace net;
 
-uint32_t Manager::_step = 1;
+namespace
+{
+struct Migration
+{
+	IConnection_var conn;
+	uint32_t connid;
+};
+
+void io_thread_adopt_connection(const Migration& m)
+{
+	Manager::get()->adopt(m.conn.ptr(), m.connid);
+}
+}
 
 Manager* Manager::get(const uint32_t id)
 {
@@ -17,7 +32,7 @@ Manager* Manager::get(const uint32_t id)
     if(!r)
     {
     	GLINFO << "create router in thread local memory, id: " << id;
-    	std::cout << "create router in thread local memory, id: " << id << " max: " << Manager::_step << std::endl;
+    	std::cout << "create router in thread local memory, id: " << id << std::endl;
     	r = new Manager(id);
     	inst.set(r);
     }
@@ -26,16 +41,16 @@ Manager* Manager::get(const uint32_t id)
 
 uint32_t Manager::getConnectionId()
 {
-	//type : socket id hash on this connection,there use 4bit (0-8)
+	//连接ID中带上所属线程, 跨线程调度时一次到达
     uint32_t connid;
     do
     {
-    	_seed += Manager::_step;
+    	_seed = (_seed + 1) & CONNID_SEQ_MASK;
         if(_seed == 0)
         {
-        	_seed += Manager::_step;
+        	_seed = 1;
         }
-        connid = _seed;
+        connid = makeConnId(_owner, _seed);
     }while(_connections.find(connid) != _connections.end());
     return connid;
 }
@@ -99,7 +114,7 @@ uint32_t Manager::createTcpClient(const std::string& host, const int port, const
 		return 0;
 	}
 
-	GLINFO << "connect connid: " << newConnId << "|" << Manager::_step << " (" << (newConnId%Manager::_step) << ") to " << host << ":" << port;
+	GLINFO << "connect connid: " << newConnId << " (" << getConnIdOwner(newConnId) << ") to " << host << ":" << port;
 	return newConnId;
 }
 
@@ -120,7 +135,7 @@ uint32_t Manager::createTcpConnection(const SOCKET s, const uint32_t ip, const i
 	    return 0;
 	}
 
-	GLINFO << "accept connid: " << newConnId << "|" << Manager::_step << " (" << (newConnId%Manager::_step) << ") " << conn->dump();
+	GLINFO << "accept connid: " << newConnId << " (" << getConnIdOwner(newConnId) << ") " << conn->dump();
 
 	//连接回调
 	handler->onConnected(conn.ptr());
@@ -128,7 +143,7 @@ uint32_t Manager::createTcpConnection(const SOCKET s, const uint32_t ip, const i
 	return newConnId;
 }
 
-uint32_t Manager::createUdpClient(const std::string& host, const int port, IClientHandler* handler)
+uint32_t Manager::createUdpClient(const std::string& host, const int port, IClientHandler* handler, const ArqConfig* arq)
 {
 	uint32_t newConnId = getConnectionId();
 	IConnection_var conn(new UdpClient(host, port, newConnId, handler, this));
@@ -146,7 +161,12 @@ uint32_t Manager::createUdpClient(const std::string& host, const int port, IClie
 		return 0;
 	}
 
-	GLINFO << "connect connid: " << newConnId << "|" << Manager::_step << " (" << (newConnId%Manager::_step) << ") to " << host << ":" << port;
+	GLINFO << "connect connid: " << newConnId << " (" << getConnIdOwner(newConnId) << ") to " << host << ":" << port;
+
+	if(arq)
+	{
+		((UdpConnection*)conn.ptr())->setArq(*arq);
+	}
 
 	//必须在addConnection处理连接事件，否则发消息时可能找不到连接ID
 	((UdpConnection*)conn.ptr())->handleOnConnected();
@@ -155,7 +175,7 @@ uint32_t Manager::createUdpClient(const std::string& host, const int port, IClie
 }
 
 //只能在IO worker线程中执行
-uint32_t Manager::createUdpConnection(const SOCKET s, const uint32_t ip, const int port, const int timeout, const std::string& data, IClientHandler* handler, ISocketManager* listener)
+uint32_t Manager::createUdpConnection(const SOCKET s, const uint32_t ip, const int port, const int timeout, const std::string& data, IClientHandler* handler, ISocketManager* listener, const ArqConfig* arq)
 {
 	uint32_t curConnId = listener->getConnId(ip, port);
 	if(curConnId)
@@ -164,7 +184,7 @@ uint32_t Manager::createUdpConnection(const SOCKET s, const uint32_t ip, const i
 		if(conn)
 		{
 			GLINFO << "accept socket: " << s << " data size: " << data.size() << " " << conn->dump();
-			conn->getHandler()->onData(data.data(), (uint32_t)data.size(), conn);
+			((UdpConnection*)conn)->onDatagram(data.data(), (uint32_t)data.size());
 			return curConnId;
 		}
 	}
@@ -187,19 +207,147 @@ uint32_t Manager::createUdpConnection(const SOCKET s, const uint32_t ip, const i
 	    return 0;
 	}
 
-	GLINFO << "accept socket: " << s << " connid: " << newConnId << "|" << Manager::_step << " (" << (newConnId%Manager::_step) << ") " << conn->dump();
+	GLINFO << "accept socket: " << s << " connid: " << newConnId << " (" << getConnIdOwner(newConnId) << ") " << conn->dump();
+
+	if(arq)
+	{
+		((UdpConnection*)conn.ptr())->setArq(*arq);
+	}
 
 	//连接回调
 	handler->onConnected(conn.ptr());
 
 	//马上处理数据
-	handler->onData(data.data(), (uint32_t)data.size(), conn.ptr());
+	((UdpConnection*)conn.ptr())->onDatagram(data.data(), (uint32_t)data.size());
 
 	((UdpConnection*)conn.ptr())->_recvBytes += (uint32_t)data.size();
 
 	return newConnId;
 }
 
+//只能在IO worker线程中执行
+bool Manager::migrate(const uint32_t connid, const uint32_t target)
+{
+	if(target == _owner)
+	{
+		return true;
+	}
+	if(target == 0 || target >= Scheduler::instance().getWorkerSize())
+	{
+		GLERROR << "migrate connid: " << connid << " to invalid worker: " << target;
+		return false;
+	}
+
+	Connections::iterator it = _connections.find(connid);
+	if(it == _connections.end())
+	{
+		GLWARN << "migrate connid: " << connid << " not found";
+		return false;
+	}
+	//UDP连接共用服务端的socket和对端表, 不支持迁移
+	TcpConnection* conn = dynamic_cast<TcpConnection*>(it->second.ptr());
+	if(!conn || !conn->detach())
+	{
+		GLWARN << "migrate connid: " << connid << " failed, only established tcp connection can migrate";
+		return false;
+	}
+
+	Migration m;
+	m.conn = it->second;
+	m.connid = connid;
+	_connections.erase(it);
+	_bytes.erase(connid);
+
+	if(!Scheduler::instance().scheduleTo(target, io_thread_adopt_connection, m, "adoptConnection", PRIORITY_URGENT))
+	{
+		//投递失败, 留在本线程
+		GLERROR << "migrate connid: " << connid << " to worker: " << target << " failed, " << Scheduler::lastError();
+		if(conn->attach(connid, this))
+		{
+			addConnection(conn);
+		}
+		return false;
+	}
+	return true;
+}
+
+//只能在IO worker线程中执行
+uint32_t Manager::adopt(IConnection* conn, const uint32_t oldConnId)
+{
+	uint32_t newConnId = getConnectionId();
+	TcpConnection* tcp = dynamic_cast<TcpConnection*>(conn);
+	if(!tcp || !tcp->attach(newConnId, this))
+	{
+		GLERROR << "adopt connid: " << oldConnId << " failed";
+		return 0;
+	}
+	if(!addConnection(conn))
+	{
+		GLERROR << "add connid: " << newConnId << " migrated from " << oldConnId << " failed!";
+		return 0;
+	}
+	//迁移过来的连接从当前字节数开始计算负载
+	_bytes[newConnId] = conn->getRecvBytes() + conn->getSentBytes();
+
+	GLINFO << "migrate connid: " << oldConnId << " (" << getConnIdOwner(oldConnId) << ") -> " << newConnId << " (" << _owner << ") " << conn->dump();
+
+	try
+	{
+		conn->getHandler()->onMigrated(oldConnId, conn);
+	}
+	catch(const std::exception& e)
+	{
+		GLERROR << "ignore exception from callback 'onMigrated': " << e.what();
+	}
+	return newConnId;
+}
+
+uint64_t Manager::sample()
+{
+	uint64_t total(0);
+	std::map<uint32_t, uint64_t> bytes;
+	_hot.clear();
+	for(Connections::iterator it = _connections.begin(); it != _connections.end(); it++)
+	{
+		IConnection* conn = it->second.ptr();
+		uint64_t b = conn->getRecvBytes() + conn->getSentBytes();
+		std::map<uint32_t, uint64_t>::iterator last = _bytes.find(it->first);
+		uint64_t delta = (last != _bytes.end() && b >= last->second) ? b - last->second : b;
+		bytes[it->first] = b;
+		total += delta;
+		if(conn->type() == IConnection::TCP && delta > 0)
+		{
+			_hot.push_back(std::make_pair(delta, it->first));
+		}
+	}
+	_bytes.swap(bytes);
+	std::sort(_hot.rbegin(), _hot.rend());
+	return total;
+}
+
+uint32_t Manager::shed(const uint32_t target, const uint64_t amount, const uint32_t maxConns)
+{
+	uint32_t moved(0);
+	uint64_t sum(0);
+	for(size_t i = 0; i < _hot.size() && moved < maxConns && sum < amount; i++)
+	{
+		//单个连接超过剩余转移量时, 迁移只会把热点换到目标线程
+		if(_hot[i].first > amount - sum)
+			continue;
+		if(migrate(_hot[i].second, target))
+		{
+			sum += _hot[i].first;
+			moved++;
+		}
+	}
+	_hot.clear();
+	if(moved > 0)
+	{
+		GLINFO << "shed " << moved << " connections load: " << sum << " from worker: " << _owner << " to worker: " << target;
+	}
+	return moved;
+}
+
 void Manager::onConnected(IConnection* conn)
 {
 	GLINFO << "---connected " << conn->dump();
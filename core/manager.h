@@ -4,6 +4,7 @@
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
+#include <vector>
 #include "utils/rc.h"
 #include "connection.h"
 
@@ -13,8 +14,10 @@ namespace net
 class Manager : public ILinkCtrlHandler
 {
 public:
+	//id为所属IO线程在Scheduler中的序号(0号为主线程)
 	Manager(const uint32_t id)
-    : _seed(id%Manager::_step)
+    : _owner(id)
+    , _seed(0)
     {
     }
 
@@ -32,14 +35,25 @@ public:
     //被动连接客户端:在IO主线程中调用
     uint32_t createTcpConnection(const SOCKET s, const uint32_t ip, const int port, const int timeout, IClientHandler* handler);
 
-    //主动连接客户端:在IO主线程中调用
-    uint32_t createUdpClient(const std::string& host, const int port, IClientHandler* handler);
+    //主动连接客户端:在IO主线程中调用, arq不为空时开启可靠传输
+    uint32_t createUdpClient(const std::string& host, const int port, IClientHandler* handler, const ArqConfig* arq = 0);
 
-    //被动连接客户端:在IO主线程中调用
-    uint32_t createUdpConnection(const SOCKET s, const uint32_t ip, const int port, const int timeout, const std::string& data, IClientHandler* handler, ISocketManager* listener);
+    //被动连接客户端:在IO主线程中调用, arq不为空时开启可靠传输
+    uint32_t createUdpConnection(const SOCKET s, const uint32_t ip, const int port, const int timeout, const std::string& data, IClientHandler* handler, ISocketManager* listener, const ArqConfig* arq = 0);
+
+    //连接迁移:在所属IO线程中调用, 把TCP连接转移到|target|号IO线程, 连接ID会变化(见IClientHandler::onMigrated)
+    bool migrate(const uint32_t connid, const uint32_t target);
+    //接收迁移的连接:在目标IO线程中调用, 返回新连接ID
+    uint32_t adopt(IConnection* conn, const uint32_t oldConnId);
+
+    //负载采样:统计上次采样以来各连接的收发字节数, 返回本线程的总量
+    uint64_t sample();
+    //按上次采样把负载最高的连接迁移到|target|号IO线程, 负载合计不超过|amount|, 最多|maxConns|个
+    uint32_t shed(const uint32_t target, const uint64_t amount, const uint32_t maxConns);
 
     //获取连接数量
     uint32_t getConnectionSize() {return _connections.size();}
+    uint32_t getOwner() const {return _owner;}
     std::string dump(const std::string& filter);
 public:
     //继承ILinkCtrlHandler
@@ -51,12 +65,6 @@ protected:
     bool addConnection(IConnection* conn);
     uint32_t getConnectionId();
 
-public:
-    static void init(const int step)
-    {
-    	Manager::_step = step;
-    }
-
 private:
     static void destroy(void* ptr)
     {
@@ -67,8 +75,10 @@ private:
 private:
     typedef std::map<uint32_t, IConnection_var> Connections;
     Connections _connections;
+    std::map<uint32_t, uint64_t> _bytes;//上次采样时各连接的收发字节数
+    std::vector<std::pair<uint64_t, uint32_t> > _hot;//上次采样的连接负载, 从高到低
+    uint32_t 	_owner;
     uint32_t 	_seed;
-    static uint32_t _step;
 };
 
 }
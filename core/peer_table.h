@@ -0,0 +1,195 @@
+#ifndef __NET_PEER_TABLE_H__
+#define __NET_PEER_TABLE_H__
+
+#include <vector>
+#include "utils/int_types.h"
+#include "utils/mutex.h"
+#include "socket_inc.h"
+
+namespace net
+{
+//UDP对端表: 按ip:port打包成64位键, 分片 + 开放寻址(线性探测)
+//每个分片一把自旋锁, 槽位连续存放, 插入不分配节点, 只在扩容时整体重分配
+class PeerTable
+{
+public:
+	enum
+	{
+		SHARD_BITS = 6,
+		SHARD_COUNT = 1 << SHARD_BITS,
+		INITIAL_CAPACITY = 16,//每个分片初始槽位数, 必须是2的幂
+	};
+
+	static uint64_t makeKey(const u_long peerIp, const int peerPort)
+	{
+		return ((uint64_t)(uint32_t)peerIp << 32) | (uint32_t)peerPort;
+	}
+
+	PeerTable()
+	{
+		for(uint32_t i = 0; i < SHARD_COUNT; i++)
+		{
+			_shards[i].reset(INITIAL_CAPACITY);
+		}
+	}
+
+	//找到返回true, 并填充|s|和|connId|
+	bool find(const uint64_t key, SOCKET& s, uint32_t& connId)
+	{
+		const uint64_t h = hash(key);
+		Shard& shard = _shards[h >> (64 - SHARD_BITS)];
+		lin_io::ScopLock<lin_io::SpinLock> sync(shard.lock);
+		const Slot* slot = shard.lookup(key, h);
+		if(!slot)
+			return false;
+		s = slot->s;
+		connId = slot->connId;
+		return true;
+	}
+
+	//已存在时覆盖
+	void insert(const uint64_t key, const SOCKET s, const uint32_t connId)
+	{
+		const uint64_t h = hash(key);
+		Shard& shard = _shards[h >> (64 - SHARD_BITS)];
+		lin_io::ScopLock<lin_io::SpinLock> sync(shard.lock);
+		Slot* slot = shard.lookup(key, h);
+		if(!slot)
+		{
+			//包括墓碑在内负载超过3/4时扩容
+			if((shard.used + 1) * 4 > shard.slots.size() * 3)
+			{
+				shard.rehash(shard.size * 2 >= shard.slots.size() / 2 ? shard.slots.size() * 2 : shard.slots.size());
+			}
+			slot = shard.vacant(h);
+			if(slot->key == EMPTY_KEY)
+				shard.used++;
+			shard.size++;
+			slot->key = key;
+		}
+		slot->s = s;
+		slot->connId = connId;
+	}
+
+	bool erase(const uint64_t key)
+	{
+		const uint64_t h = hash(key);
+		Shard& shard = _shards[h >> (64 - SHARD_BITS)];
+		lin_io::ScopLock<lin_io::SpinLock> sync(shard.lock);
+		Slot* slot = shard.lookup(key, h);
+		if(!slot)
+			return false;
+		slot->key = TOMBSTONE_KEY;
+		shard.size--;
+		return true;
+	}
+
+	bool setConnId(const uint64_t key, const uint32_t connId)
+	{
+		const uint64_t h = hash(key);
+		Shard& shard = _shards[h >> (64 - SHARD_BITS)];
+		lin_io::ScopLock<lin_io::SpinLock> sync(shard.lock);
+		Slot* slot = shard.lookup(key, h);
+		if(!slot)
+			return false;
+		slot->connId = connId;
+		return true;
+	}
+
+	size_t size()
+	{
+		size_t n = 0;
+		for(uint32_t i = 0; i < SHARD_COUNT; i++)
+		{
+			lin_io::ScopLock<lin_io::SpinLock> sync(_shards[i].lock);
+			n += _shards[i].size;
+		}
+		return n;
+	}
+
+private:
+	//端口不超过16位, 低32位全1的键不会出现, 可用作空槽和墓碑标记
+	static const uint64_t EMPTY_KEY = 0xFFFFFFFFFFFFFFFFULL;
+	static const uint64_t TOMBSTONE_KEY = 0xFFFFFFFFFFFFFFFEULL;
+
+	struct Slot
+	{
+		uint64_t key;
+		SOCKET   s;
+		uint32_t connId;
+	};
+
+	struct Shard
+	{
+		lin_io::SpinLock lock;
+		std::vector<Slot> slots;
+		size_t size;//有效键数
+		size_t used;//有效键 + 墓碑数
+		char pad[64];//相邻分片的锁不落在同一缓存行
+
+		void reset(const size_t capacity)
+		{
+			Slot empty = {EMPTY_KEY, 0, 0};
+			slots.assign(capacity, empty);
+			size = 0;
+			used = 0;
+		}
+
+		Slot* lookup(const uint64_t key, const uint64_t h)
+		{
+			const size_t mask = slots.size() - 1;
+			for(size_t i = h & mask; ; i = (i + 1) & mask)
+			{
+				Slot& slot = slots[i];
+				if(slot.key == key)
+					return &slot;
+				if(slot.key == EMPTY_KEY)
+					return 0;
+			}
+		}
+
+		//第一个空槽或墓碑, 调用前必须确认键不存在
+		Slot* vacant(const uint64_t h)
+		{
+			const size_t mask = slots.size() - 1;
+			for(size_t i = h & mask; ; i = (i + 1) & mask)
+			{
+				if(slots[i].key == EMPTY_KEY || slots[i].key == TOMBSTONE_KEY)
+					return &slots[i];
+			}
+		}
+
+		//容量不变时只清理墓碑
+		void rehash(const size_t capacity)
+		{
+			std::vector<Slot> old;
+			old.swap(slots);
+			reset(capacity);
+			for(size_t i = 0; i < old.size(); i++)
+			{
+				if(old[i].key == EMPTY_KEY || old[i].key == TOMBSTONE_KEY)
+					continue;
+				*vacant(hash(old[i].key)) = old[i];
+				size++;
+				used++;
+			}
+		}
+	};
+
+	//splitmix64终结函数: 高位选分片, 低位选槽位
+	static uint64_t hash(uint64_t key)
+	{
+		key ^= key >> 30;
+		key *= 0xbf58476d1ce4e5b9ULL;
+		key ^= key >> 27;
+		key *= 0x94d049bb133111ebULL;
+		key ^= key >> 31;
+		return key;
+	}
+
+private:
+	Shard _shards[SHARD_COUNT];
+};
+}
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef __NET_PENDING_TABLE_H__
+#define __NET_PENDING_TABLE_H__
+
+#include <vector>
+#include "utils/int_types.h"
+#include "future.h"
+
+namespace net
+{
+//连接上等待响应的调用表: 整数序号 -> future
+//开放寻址(线性探测), 删除时把后续槽位前移, 不留墓碑; 插入和删除不分配内存, 只在扩容时整体重分配
+//只在所属IO线程访问, 不加锁
+class PendingTable
+{
+public:
+	enum
+	{
+		INITIAL_CAPACITY = 16,//必须是2的幂
+	};
+
+	PendingTable():_size(0),_mask(0) {}
+
+	size_t size() const {return _size;}
+	bool empty() const {return _size == 0;}
+
+	//已存在时替换, 原来的future通过|old|返回
+	bool insert(const uint64_t sn, IFuture* future, IFuturevar& old)
+	{
+		if((_size + 1) * 2 > _slots.size())
+		{
+			rehash(_slots.empty() ? (size_t)INITIAL_CAPACITY : _slots.size() * 2);
+		}
+		size_t i = hash(sn) & _mask;
+		for(;; i = (i + 1) & _mask)
+		{
+			Slot& slot = _slots[i];
+			if(!slot.future.ptr())
+			{
+				slot.key = sn;
+				slot.future = future;
+				_size++;
+				return false;
+			}
+			if(slot.key == sn)
+			{
+				old = slot.future;
+				slot.future = future;
+				return true;
+			}
+		}
+	}
+
+	//找到时取出
+	bool take(const uint64_t sn, IFuturevar& future)
+	{
+		size_t i;
+		if(!lookup(sn, i))
+			return false;
+		future = _slots[i].future;
+		removeAt(i);
+		return true;
+	}
+
+	bool erase(const uint64_t sn)
+	{
+		size_t i;
+		if(!lookup(sn, i))
+			return false;
+		removeAt(i);
+		return true;
+	}
+
+	//按槽位遍历, 空槽位返回0
+	size_t capacity() const {return _slots.size();}
+	IFuture* at(const size_t i) const {return _slots[i].future.ptr();}
+
+	//取出全部
+	void takeAll(std::vector<IFuturevar>& futures)
+	{
+		for(size_t i = 0; i < _slots.size(); i++)
+		{
+			if(_slots[i].future.ptr())
+			{
+				futures.push_back(_slots[i].future);
+				_slots[i].future = (IFuture*)0;
+			}
+		}
+		_size = 0;
+	}
+
+private:
+	struct Slot
+	{
+		Slot():key(0) {}
+		uint64_t key;
+		IFuturevar future;//为空表示空槽位
+	};
+
+	//splitmix64, 连续序号分散到不同槽位
+	static uint64_t hash(uint64_t x)
+	{
+		x ^= x >> 30;
+		x *= 0xbf58476d1ce4e5b9ULL;
+		x ^= x >> 27;
+		x *= 0x94d049bb133111ebULL;
+		x ^= x >> 31;
+		return x;
+	}
+
+	bool lookup(const uint64_t sn, size_t& index) const
+	{
+		if(_size == 0)
+			return false;
+		for(size_t i = hash(sn) & _mask;; i = (i + 1) & _mask)
+		{
+			const Slot& slot = _slots[i];
+			if(!slot.future.ptr())
+				return false;
+			if(slot.key == sn)
+			{
+				index = i;
+				return true;
+			}
+		}
+	}
+
+	//后移删除: 把探测链上可以前移的槽位填到空位, 保证查找不会提前遇到空槽位
+	void removeAt(size_t i)
+	{
+		size_t j = i;
+		for(;;)
+		{
+			j = (j + 1) & _mask;
+			if(!_slots[j].future.ptr())
+				break;
+			size_t k = hash(_slots[j].key) & _mask;
+			//k在(i, j]之间(环形)时不能前移
+			bool between = i <= j ? (i < k && k <= j) : (i < k || k <= j);
+			if(!between)
+			{
+				_slots[i].key = _slots[j].key;
+				_slots[i].future = _slots[j].future;
+				i = j;
+			}
+		}
+		_slots[i].future = (IFuture*)0;
+		_size--;
+	}
+
+	void rehash(const size_t capacity)
+	{
+		std::vector<Slot> slots(capacity);
+		slots.swap(_slots);
+		_mask = capacity - 1;
+		for(size_t n = 0; n < slots.size(); n++)
+		{
+			if(!slots[n].future.ptr())
+				continue;
+			size_t i = hash(slots[n].key) & _mask;
+			while(_slots[i].future.ptr())
+			{
+				i = (i + 1) & _mask;
+			}
+			_slots[i].key = slots[n].key;
+			_slots[i].future = slots[n].future;
+		}
+	}
+
+private:
+	std::vector<Slot> _slots;
+	size_t _size;
+	size_t _mask;
+};
+}
+
+#endif
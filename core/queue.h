@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include <deque>
 #include <vector>
+#include <atomic>
 #include "utils/mutex.h"
 #include "selector.h"
 #include "handler.h"
@@ -144,6 +145,196 @@ private:
     uint8_t _notify; /// when queue was empty,force notify next time
 };
 
+/// 侵入式无锁队列的链接节点, 消息需要继承
+struct MpscNode
+{
+    MpscNode() : _mpscNext(0) {}
+    std::atomic<MpscNode*> _mpscNext;
+};
+
+/// intrusive lock-free multi-producer single-consumer queue with notify (Vyukov)
+/// 生产者只做一次原子交换, 消费者不加锁; size()是近似值
+/// LANES个独立通道共用一个通知, 由消费者决定各通道的取出顺序
+template <typename MESSAGE, typename NOTIFIER = Notifier, int LANES = 1>
+class MpscQueue
+{
+public:
+    typedef Notifier::SignalHandler SignalHandler;
+
+public:
+    MpscQueue(): _notify(1)
+    {
+    }
+    virtual ~MpscQueue() { _clear(); }
+
+    /// @brief  连接队列事件监听
+    ///          call by consumer thread
+    void connect(SignalHandler* handler)
+    {
+        notifier_.connect(handler);
+    }
+    /// @brief  断开队列事件监听
+    void disconnect(SignalHandler* handler)
+    {
+        notifier_.disconnect(handler);
+    }
+    /// @brief  append message into queue
+    ///         call by producer thread
+    void push(MESSAGE* msg, const int lane = 0)
+    {
+        assert(msg);
+        _lanes[lane].link(msg, msg);
+        _lanes[lane].size.fetch_add(1, std::memory_order_relaxed);
+        wakeup();
+    }
+    /// @brief  append a linked chain of |count| messages with one exchange
+    ///         链内已用_mpscNext从first连到last
+    ///         call by producer thread
+    void push(MESSAGE* first, MESSAGE* last, const size_t count, const int lane = 0)
+    {
+        assert(first && last);
+        _lanes[lane].link(first, last);
+        _lanes[lane].size.fetch_add(count, std::memory_order_relaxed);
+        wakeup();
+    }
+    /// @brief  pop message from queue, lanes in order
+    /// @return return the message in queue head
+    ///         if queue is empty,return NULL and force notify next time
+    ///         call by consumer thread
+    MESSAGE* pop()
+    {
+        for (;;)
+        {
+            for (int i = 0; i < LANES; ++i)
+            {
+                MpscNode* node = _lanes[i].tryPop();
+                if (node)
+                    return static_cast<MESSAGE*>(node);
+            }
+            if (rest())
+                return 0;
+        }
+    }
+    /// @brief  pop message from |lane|, do not touch notify
+    ///         call by consumer thread
+    MESSAGE* pop(const int lane)
+    {
+        return static_cast<MESSAGE*>(_lanes[lane].tryPop());
+    }
+    /// @brief  所有通道取空后调用, 开启下次通知
+    /// @return false表示期间又有消息入队, 需要继续处理
+    bool rest()
+    {
+        _notify.store(1);
+        //重新检查, 避免设置通知标记前入队的消息丢失通知
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        for (int i = 0; i < LANES; ++i)
+        {
+            if (!_lanes[i].empty())
+                return false;
+        }
+        return true;
+    }
+    /// @brief  消费者主动补发通知(本轮没有取完时使用)
+    void notify()
+    {
+        notifier_.notify();
+    }
+    /// @brief  return approximate messages num in queue
+    size_t size() const
+    {
+        size_t n = 0;
+        for (int i = 0; i < LANES; ++i)
+        {
+            n += size(i);
+        }
+        return n;
+    }
+    size_t size(const int lane) const
+    {
+        long n = _lanes[lane].size.load(std::memory_order_relaxed);
+        return n > 0 ? (size_t)n : 0;
+    }
+
+private:
+    struct Lane
+    {
+        Lane(): head(&stub), tail(&stub), size(0) {}
+
+        void link(MpscNode* first, MpscNode* last)
+        {
+            last->_mpscNext.store(0, std::memory_order_relaxed);
+            MpscNode* prev = head.exchange(last, std::memory_order_acq_rel);
+            prev->_mpscNext.store(first, std::memory_order_release);
+        }
+
+        MpscNode* tryPop()
+        {
+            MpscNode* node = tail;
+            MpscNode* next = node->_mpscNext.load(std::memory_order_acquire);
+            if (node == &stub)
+            {
+                if (!next)
+                    return 0;
+                tail = next;
+                node = next;
+                next = next->_mpscNext.load(std::memory_order_acquire);
+            }
+            if (!next)
+            {
+                //生产者交换了head但还没有链接上, 视为空
+                if (node != head.load(std::memory_order_acquire))
+                    return 0;
+                link(&stub, &stub);
+                next = node->_mpscNext.load(std::memory_order_acquire);
+                if (!next)
+                    return 0;
+            }
+            tail = next;
+            size.fetch_sub(1, std::memory_order_relaxed);
+            return node;
+        }
+
+        //链接未完成的生产者会在之后检查通知标记
+        bool empty() const
+        {
+            return tail == &stub && !stub._mpscNext.load(std::memory_order_acquire);
+        }
+
+        std::atomic<MpscNode*> head;//生产者端
+        char pad[64];//生产者和消费者不共享缓存行
+        MpscNode* tail;//消费者端
+        MpscNode stub;
+        std::atomic<long> size;
+    };
+
+    //消费者把队列取空后才需要通知
+    void wakeup()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (_notify.exchange(0))
+        {
+            notifier_.notify();
+        }
+    }
+
+    void _clear()
+    {
+        for (int i = 0; i < LANES; ++i)
+        {
+            for (MpscNode* node = _lanes[i].tryPop(); node; node = _lanes[i].tryPop())
+            {
+                delete static_cast<MESSAGE*>(node);
+            }
+        }
+    }
+
+private:
+    Lane _lanes[LANES];
+    std::atomic<uint8_t> _notify; /// when queue was empty,force notify next time
+    NOTIFIER notifier_;
+};
+
 template <typename MESSAGE>
 class SingleConsumerQueue : public MessageQueue<MESSAGE, Notifier>
 {
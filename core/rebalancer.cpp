@@ -0,0 +1,116 @@
+#include "rebalancer.h"
+#include <algorithm>
+#include "log/logger.h"
+#include "scheduler.h"
+#include "manager.h"
+
+using namespace net;
+
+namespace
+{
+struct ShedContext
+{
+	uint32_t target;
+	uint64_t amount;
+	uint32_t maxConns;
+};
+
+void io_thread_sample(const uint32_t& index)
+{
+	Worker* worker = Scheduler::instance().getWorker(index);
+	if(worker)
+	{
+		worker->setLoad(Manager::get()->sample());
+	}
+}
+
+void io_thread_shed(const ShedContext& ctx)
+{
+	Manager::get()->shed(ctx.target, ctx.amount, ctx.maxConns);
+}
+}
+
+Rebalancer::Rebalancer()
+:_threshold(50)
+,_maxConns(8)
+{
+}
+
+bool Rebalancer::start(const int intervalMs, const uint32_t threshold, const uint32_t maxConns)
+{
+	lin_io::ScopLock<lin_io::SpinLock> sync(_lock);
+	if(_timer.pending())
+	{
+		GLINFO << "rebalancer is running";
+		return true;
+	}
+	if(intervalMs <= 0)
+	{
+		GLERROR << "rebalance interval: " << intervalMs << " is invalid";
+		return false;
+	}
+
+	_threshold = threshold;
+	_maxConns = maxConns;
+	_timer = Scheduler::instance().scheduleEvery(0, intervalMs, this, &Rebalancer::balance, intervalMs, "rebalance");
+	if(!_timer.valid())
+	{
+		GLERROR << "start rebalancer failed";
+		return false;
+	}
+	GLINFO << "start rebalancer, interval: " << intervalMs << " ms threshold: " << threshold << "% max connections: " << maxConns;
+	return true;
+}
+
+void Rebalancer::stop()
+{
+	lin_io::ScopLock<lin_io::SpinLock> sync(_lock);
+	_timer.cancel();
+	_timer.reset();
+}
+
+void Rebalancer::balance(const int& intervalMs)
+{
+	Scheduler& scheduler = Scheduler::instance();
+	const uint32_t size = scheduler.getWorkerSize();
+	//至少两个子线程
+	if(size < 3)
+		return;
+
+	//按上一个周期的采样结果选出最忙和最空闲的线程
+	uint32_t hot(0), cold(0);
+	uint64_t total(0), maxLoad(0), minLoad(~0ULL);
+	for(uint32_t i = 1; i < size; i++)
+	{
+		uint64_t load = scheduler.getWorker(i)->getLoad();
+		total += load;
+		if(hot == 0 || load > maxLoad)
+		{
+			maxLoad = load;
+			hot = i;
+		}
+		if(cold == 0 || load < minLoad)
+		{
+			minLoad = load;
+			cold = i;
+		}
+	}
+
+	uint64_t avg = total / (size - 1);
+	if(hot != cold && avg > 0 && maxLoad * 100 > avg * (100 + _threshold.load()))
+	{
+		//转移后两边都不超过平均值
+		ShedContext ctx;
+		ctx.target = cold;
+		ctx.amount = std::min(maxLoad - avg, avg - minLoad);
+		ctx.maxConns = _maxConns.load();
+		GLINFO << "rebalance worker: " << hot << " load: " << maxLoad << " -> worker: " << cold << " load: " << minLoad << " avg: " << avg;
+		scheduler.scheduleTo(hot, io_thread_shed, ctx, "rebalance", PRIORITY_URGENT);
+	}
+
+	//重新采样, 迁移任务先于采样执行
+	for(uint32_t i = 1; i < size; i++)
+	{
+		scheduler.scheduleTo(i, io_thread_sample, i, "sample", PRIORITY_URGENT);
+	}
+}
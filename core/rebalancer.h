@@ -0,0 +1,36 @@
+#ifndef __NET_REBALANCER_H__
+#define __NET_REBALANCER_H__
+
+#include "utils/mutex.h"
+#include "timer_task.h"
+
+namespace net
+{
+//连接负载均衡: 按周期采样各IO线程连接的收发字节数, 最忙的线程超过平均值一定比例时,
+//把它上面的部分TCP连接迁移到最空闲的线程(连接ID会变化, 见IClientHandler::onMigrated)
+class Rebalancer
+{
+	Rebalancer();
+public:
+	static Rebalancer& instance()
+	{
+		static Rebalancer ins;
+		return ins;
+	}
+
+	//|intervalMs|为采样周期, 最忙线程超过平均值|threshold|%时迁移, 每个周期最多迁移|maxConns|个连接
+	bool start(const int intervalMs, const uint32_t threshold = 50, const uint32_t maxConns = 8);
+	void stop();
+
+	//定时器回调, 在IO线程执行
+	void balance(const int& intervalMs);
+
+private:
+	lin_io::SpinLock _lock;
+	TimerHandle _timer;
+	std::atomic<uint32_t> _threshold;
+	std::atomic<uint32_t> _maxConns;
+};
+}
+
+#endif
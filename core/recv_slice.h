@@ -0,0 +1,79 @@
+#ifndef __NET_RECV_SLICE_H__
+#define __NET_RECV_SLICE_H__
+
+#include <string.h>
+#include "utils/rc.h"
+#include "task_pool.h"
+
+namespace net
+{
+//接收数据块: 连接输入缓冲区的存储在被切片引用时整体移交过来, 最后一个切片释放时删除
+class RecvBlock : public lin_io::LockedRefCount
+{
+public:
+	RecvBlock():_storage(0) {}
+	virtual ~RecvBlock() {delete[] _storage;}
+
+	//接管new[]分配的存储
+	void adopt(char* storage) {_storage = storage;}
+
+private:
+	RecvBlock(const RecvBlock&);
+	RecvBlock& operator=(const RecvBlock&);
+
+private:
+	char* _storage;
+};
+
+typedef lin_io::RcVar<RecvBlock> RecvBlockvar;
+
+//响应帧的只读切片: 引用接收数据块中的一段, 可以跨线程传递和释放
+//在切片上Unpack出的Varstr等视图字段直接指向帧内数据, 只要切片还被引用就有效
+class RecvSlice : public lin_io::LockedRefCount
+{
+public:
+	RecvSlice(RecvBlock* block, const char* data, const uint32_t size)
+	:_block(block), _data(data), _size(size)
+	{
+	}
+	virtual ~RecvSlice() {}
+
+	//不在连接输入缓冲区中的数据(或连接不支持切片)时拷贝一份
+	static RecvSlice* copy(const char* data, const uint32_t size)
+	{
+		char* storage = new char[size ? size : 1];
+		memcpy(storage, data, size);
+		RecvBlock* block = new RecvBlock();
+		block->adopt(storage);
+		return new RecvSlice(block, storage, size);
+	}
+
+	const char* data() const {return _data;}
+	uint32_t size() const {return _size;}
+
+	static void* operator new(size_t size) {return TaskPool::alloc(size);}
+	static void operator delete(void* ptr) {TaskPool::free(ptr);}
+
+private:
+	RecvSlice(const RecvSlice&);
+	RecvSlice& operator=(const RecvSlice&);
+
+private:
+	RecvBlockvar _block;
+	const char*  _data;
+	uint32_t     _size;
+};
+
+typedef lin_io::RcVar<RecvSlice> RecvSlicevar;
+
+//零拷贝响应: |view|中的指针字段(如Varstr)引用|slice|中的数据
+//作为Reply类型传给call/async_call, 交给future时只拷贝视图和切片引用
+template<class T>
+struct SlicedReply
+{
+	RecvSlicevar slice;
+	T            view;
+};
+}
+
+#endif
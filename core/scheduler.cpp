@@ -2,7 +2,51 @@
 #include "log/logger.h"
 using namespace net;
 
-Scheduler::Scheduler():_quit(false)
+namespace
+{
+//每个目标线程一条用_mpscNext串起来的任务链
+struct TaskBatch
+{
+	Task* first;
+	Task* last;
+	uint32_t count;
+};
+
+struct BatchStaging
+{
+	BatchStaging():depth(0) {}
+	uint32_t depth;
+	std::vector<TaskBatch> batches;
+};
+
+BatchStaging& staging()
+{
+	static thread_local BatchStaging s;
+	return s;
+}
+
+//当前线程最近一次调度的结果
+ScheduleError& lastErrorRef()
+{
+	static thread_local ScheduleError err = SCHEDULE_OK;
+	return err;
+}
+
+bool fail(Task* c, const ScheduleError err)
+{
+	lastErrorRef() = err;
+	delete c;
+	return false;
+}
+}
+
+Scheduler::Scheduler()
+:_quit(false)
+,_taskBudget(Worker::DEFAULT_TASK_BUDGET)
+,_timeBudget(Worker::DEFAULT_TIME_BUDGET)
+,_policy(SHED_FAIL_FAST)
+,_target(Worker::DEFAULT_SOJOURN_TARGET)
+,_interval(Worker::DEFAULT_SOJOURN_INTERVAL)
 {
 }
 
@@ -20,71 +64,245 @@ void Scheduler::stop()
 	_workers.clear();
 }
 
-void Scheduler::start(const int num)
+void Scheduler::start(const int num, const CpuAffinity affinity)
 {
+	//子线程按策略依次绑核, 0号主线程不绑
+	std::vector<int> cpus = CpuTopology::instance().order(affinity);
+
 	//启动N个线程，其中0号为主线程
 	for(int i = 0; i < num+1; i++)
 	{
 		auto w = new Worker(i);
+		if(i > 0 && !cpus.empty())
+			w->setCpu(cpus[(i-1) % cpus.size()]);
+		w->setBudget(_taskBudget, _timeBudget);
+		w->setAdmission(_policy, _target, _interval);
 		w->start();
 		_workers.push_back(w);
 	}
-	GLINFO << "start thread size: " << num;
+	GLINFO << "start thread size: " << num << " affinity: " << affinity;
 }
 
-bool Scheduler::schedule(Task *c)
+void Scheduler::setBudget(const uint32_t tasks, const uint32_t us)
+{
+	_taskBudget = tasks;
+	_timeBudget = us;
+	for(auto it = _workers.begin(); it != _workers.end(); it++)
+	{
+		(*it)->setBudget(tasks, us);
+	}
+	GLINFO << "set worker budget, tasks: " << tasks << " us: " << us;
+}
+
+bool Scheduler::schedule(Task *c, const TaskPriority priority)
 {
 	if(_quit)
 	{
 		GLINFO << "server downing....worker cannot add anymore";
-		delete c;
-		return false;
+		return fail(c, SCHEDULE_QUIT);
 	}
 
 	if(_workers.empty())
 	{
 		GLERROR << "worker size: " << _workers.size() << " add task failed, name: " << c->name();
-		delete c;
-		return false;
+		return fail(c, SCHEDULE_NO_WORKER);
 	}
 
-	uint32_t index = 0;
-	Worker* worker = _workers[index];
-	if(!worker->addTask(c))
+	return submit(0, c, priority);
+}
+
+bool Scheduler::schedule(const uint32_t hashkey, Task *c, const TaskPriority priority)
+{
+	if(_workers.size() < 2)
 	{
-		GLERROR << "index: " << index << " size: " << worker->getQueueSize() << " add task failed, name: " << c->name();
-		delete c;
-		return false;
+		GLERROR << "worker size: " << _workers.size() << " add task failed, name: " << c->name();
+		return fail(c, SCHEDULE_NO_WORKER);
 	}
+	return scheduleTo(route(hashkey), c, priority);
+}
 
-	return true;
+bool Scheduler::scheduleConnection(const uint32_t connid, Task *c, const TaskPriority priority)
+{
+	if(_workers.size() < 2)
+	{
+		GLERROR << "worker size: " << _workers.size() << " add task failed, connid: " << connid << " name: " << c->name();
+		return fail(c, SCHEDULE_NO_WORKER);
+	}
+	return scheduleTo(routeConnection(connid), c, priority);
 }
 
-bool Scheduler::schedule(const uint32_t hashkey, Task *c)
+bool Scheduler::scheduleTo(const uint32_t index, Task* c, const TaskPriority priority)
 {
 	if(_quit)
 	{
 		GLINFO << "server downing....worker can not add anymore";
-		delete c;
-		return false;
+		return fail(c, SCHEDULE_QUIT);
 	}
 
-	if(_workers.size() < 2)
+	if(index >= _workers.size())
 	{
-		GLERROR << "worker size: " << _workers.size() << " add task failed, name: " << c->name();
-		delete c;
-		return false;
+		GLERROR << "index: " << index << " worker size: " << _workers.size() << " add task failed, name: " << c->name();
+		return fail(c, SCHEDULE_NO_WORKER);
 	}
 
-	uint32_t index = hashkey % (_workers.size()-1) + 1;
+	return submit(index, c, priority);
+}
+
+ScheduleError Scheduler::post(const uint32_t index, Task* c, const TaskPriority priority)
+{
+	ScheduleError err = SCHEDULE_OK;
+	if(_quit)
+		err = SCHEDULE_QUIT;
+	else if(index >= _workers.size())
+		err = SCHEDULE_NO_WORKER;
+	else
+		err = _workers[index]->addTask(c, priority);
+	lastErrorRef() = err;
+	return err;
+}
+
+//队列满或过载时快速失败, 由Worker限频记录日志
+bool Scheduler::submit(const uint32_t index, Task* c, const TaskPriority priority)
+{
 	Worker* worker = _workers[index];
-	if(!worker->addTask(c))
+	ScheduleError err = SCHEDULE_OK;
+	if(staging().depth > 0)
 	{
-		GLINFO << "index: " << index << " size: " << worker->getQueueSize() << " add task failed, name: " << c->name();
+		//批量作用域内也先检查, 过载时不再暂存
+		err = worker->admit(priority);
+		if(err == SCHEDULE_OK)
+			stage(index, c, priority);
+	}
+	else
+	{
+		err = worker->addTask(c, priority);
+	}
+
+	if(err != SCHEDULE_OK)
+		return fail(c, err);
+	lastErrorRef() = SCHEDULE_OK;
+	return true;
+}
+
+ScheduleError Scheduler::lastError()
+{
+	return lastErrorRef();
+}
+
+void Scheduler::setAdmission(const ShedPolicy policy, const uint32_t targetUs, const uint32_t intervalUs)
+{
+	_policy = policy;
+	_target = targetUs;
+	_interval = intervalUs;
+	for(auto it = _workers.begin(); it != _workers.end(); it++)
+	{
+		(*it)->setAdmission(policy, targetUs, intervalUs);
+	}
+	GLINFO << "set worker admission, policy: " << policy << " target: " << targetUs << "us interval: " << intervalUs << "us";
+}
+
+TimerHandle Scheduler::scheduleAfter(const uint32_t hashkey, const int ms, Task* c)
+{
+	return scheduleTimer(hashkey, new TaskTimer(c, ms, 0));
+}
+
+TimerHandle Scheduler::scheduleEvery(const uint32_t hashkey, const int ms, Task* c)
+{
+	return scheduleTimer(hashkey, new TaskTimer(c, ms, ms));
+}
+
+TimerHandle Scheduler::scheduleTimer(const uint32_t hashkey, TimerTask* c)
+{
+	if(_workers.size() < 2)
+	{
+		GLERROR << "worker size: " << _workers.size() << " add timer task failed, name: " << c->name();
 		delete c;
-		return false;
+		return TimerHandle();
 	}
 
+	//投递前加上句柄的引用, 任务可能在返回前就已执行完
+	c->_index = route(hashkey);
+	c->retain();
+	if(!scheduleTo(c->_index, c))
+		return TimerHandle();
+	return TimerHandle(c);
+}
+
+int Scheduler::getWorkerByCpu(const int cpu)
+{
+	if(cpu < 0)
+		return -1;
+
+	std::vector<int> near;
+	int node = CpuTopology::instance().getNode(cpu);
+	for(uint32_t i = 1; i < _workers.size(); i++)
+	{
+		int wcpu = _workers[i]->getCpu();
+		if(wcpu < 0)
+			continue;
+		if(wcpu == cpu)
+			return i;
+		if(node >= 0 && CpuTopology::instance().getNode(wcpu) == node)
+			near.push_back(i);
+	}
+	return near.empty() ? -1 : near[cpu % near.size()];
+}
+
+bool Scheduler::stage(const uint32_t index, Task* c, const TaskPriority priority)
+{
+	BatchStaging& st = staging();
+	if(st.depth == 0)
+		return false;
+
+	//每个目标线程每个优先级一条
+	if(st.batches.size() < _workers.size() * PRIORITY_COUNT)
+	{
+		TaskBatch empty = {0, 0, 0};
+		st.batches.resize(_workers.size() * PRIORITY_COUNT, empty);
+	}
+	TaskBatch& batch = st.batches[index * PRIORITY_COUNT + priority];
+	c->_queueTime = getMonotonicUs();
+	c->_mpscNext.store(0, std::memory_order_relaxed);
+	if(batch.last)
+		batch.last->_mpscNext.store(c, std::memory_order_relaxed);
+	else
+		batch.first = c;
+	batch.last = c;
+	batch.count++;
 	return true;
 }
 
+void Scheduler::flush()
+{
+	BatchStaging& st = staging();
+	for(uint32_t slot = 0; slot < st.batches.size(); slot++)
+	{
+		TaskBatch batch = st.batches[slot];
+		if(batch.count == 0)
+			continue;
+		st.batches[slot].first = st.batches[slot].last = 0;
+		st.batches[slot].count = 0;
+
+		//暂存时已通过admit()并向调用方返回成功, 这里直接入队, 不再检查也不删除
+		//(退出过程中同样入队, 已返回的TimerHandle等仍引用这些任务)
+		uint32_t index = slot / PRIORITY_COUNT;
+		TaskPriority priority = (TaskPriority)(slot % PRIORITY_COUNT);
+		_workers[index]->addTasks(batch.first, batch.last, batch.count, priority);
+	}
+}
+
+Scheduler::BatchScope::BatchScope()
+{
+	staging().depth++;
+}
+
+Scheduler::BatchScope::~BatchScope()
+{
+	if(--staging().depth == 0)
+		Scheduler::instance().flush();
+}
+
+void Scheduler::BatchScope::flush()
+{
+	Scheduler::instance().flush();
+}
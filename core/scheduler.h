@@ -1,7 +1,10 @@
 #pragma once
 
 #include <vector>
+#include "common.h"
 #include "worker.h"
+#include "timer_task.h"
+#include "cpu_affinity.h"
 
 //用于调度消息的分发
 namespace net
@@ -19,58 +22,140 @@ public:
 	virtual ~Scheduler ();
 
 	void stop();
-	void start(const int num);
+	void start(const int num, const CpuAffinity affinity = AFFINITY_NONE);
 
-	//主线程任务调度
-	bool schedule(Task* c);
+	//所有线程每轮事件循环的任务预算(见Worker::setBudget), 启动前后都可设置
+	void setBudget(const uint32_t tasks, const uint32_t us);
+	//所有线程的过载策略(见Worker::setAdmission), 启动前后都可设置
+	void setAdmission(const ShedPolicy policy, const uint32_t targetUs, const uint32_t intervalUs);
+
+	//当前线程最近一次调度的结果, schedule()返回false后用于区分失败原因
+	static ScheduleError lastError();
+
+	//主线程任务调度(priority见TaskPriority, 控制类任务使用PRIORITY_URGENT)
+	bool schedule(Task* c, const TaskPriority priority = PRIORITY_NORMAL);
 	template<typename ARG>
-	bool schedule(void(*fun)(const ARG& req), const ARG& req, const std::string& name="task")
+	bool schedule(void(*fun)(const ARG& req), const ARG& req, const TaskName& name="task", const TaskPriority priority=PRIORITY_NORMAL)
 	{
 		Executor<void,ARG>* c = new Executor<void,ARG>(fun, req, name);
-		return schedule(c);
+		return schedule(c, priority);
 	}
 
 	template<typename OBJ,typename ARG>
-	bool schedule(OBJ* obj, void(OBJ::*fun)(const ARG& req), const ARG& req, const std::string& name="task")
+	bool schedule(OBJ* obj, void(OBJ::*fun)(const ARG& req), const ARG& req, const TaskName& name="task", const TaskPriority priority=PRIORITY_NORMAL)
 	{
 		Executor<OBJ,ARG>* c = new Executor<OBJ,ARG>(obj, fun, req, name);
-		return schedule(c);
+		return schedule(c, priority);
 	}
 
 	//子线程任务调度
-	bool schedule(const uint32_t hashkey, Task* c);
+	bool schedule(const uint32_t hashkey, Task* c, const TaskPriority priority = PRIORITY_NORMAL);
 	template<typename ARG>
-	bool schedule(const uint32_t hashkey, void(*fun)(const ARG& req), const ARG& req, const std::string& name="task")
+	bool schedule(const uint32_t hashkey, void(*fun)(const ARG& req), const ARG& req, const TaskName& name="task", const TaskPriority priority=PRIORITY_NORMAL)
 	{
 		Executor<void,ARG>* c = new Executor<void,ARG>(fun, req, name);
-		return schedule(hashkey, c);
+		return schedule(hashkey, c, priority);
 	}
 
 	template<typename OBJ,typename ARG>
-	bool schedule(const uint32_t hashkey, OBJ* obj, void(OBJ::*fun)(const ARG& req), const ARG& req, const std::string& name="task")
+	bool schedule(const uint32_t hashkey, OBJ* obj, void(OBJ::*fun)(const ARG& req), const ARG& req, const TaskName& name="task", const TaskPriority priority=PRIORITY_NORMAL)
+	{
+		Executor<OBJ,ARG>* c = new Executor<OBJ,ARG>(obj, fun, req, name);
+		return schedule(hashkey, c, priority);
+	}
+
+	//连接任务调度: 按连接ID中的所属线程路由, 普通hashkey用schedule(hashkey, ...)
+	bool scheduleConnection(const uint32_t connid, Task* c, const TaskPriority priority = PRIORITY_NORMAL);
+	template<typename ARG>
+	bool scheduleConnection(const uint32_t connid, void(*fun)(const ARG& req), const ARG& req, const TaskName& name="task", const TaskPriority priority=PRIORITY_NORMAL)
+	{
+		Executor<void,ARG>* c = new Executor<void,ARG>(fun, req, name);
+		return scheduleConnection(connid, c, priority);
+	}
+	template<typename OBJ,typename ARG>
+	bool scheduleConnection(const uint32_t connid, OBJ* obj, void(OBJ::*fun)(const ARG& req), const ARG& req, const TaskName& name="task", const TaskPriority priority=PRIORITY_NORMAL)
 	{
 		Executor<OBJ,ARG>* c = new Executor<OBJ,ARG>(obj, fun, req, name);
-		return schedule(hashkey, c);
+		return scheduleConnection(connid, c, priority);
+	}
+
+	//指定子线程调度(index为Scheduler中的线程序号)
+	bool scheduleTo(const uint32_t index, Task* c, const TaskPriority priority = PRIORITY_NORMAL);
+	template<typename ARG>
+	bool scheduleTo(const uint32_t index, void(*fun)(const ARG& req), const ARG& req, const TaskName& name="task", const TaskPriority priority=PRIORITY_NORMAL)
+	{
+		Executor<void,ARG>* c = new Executor<void,ARG>(fun, req, name);
+		return scheduleTo(index, c, priority);
+	}
+
+	//投递到|index|号线程, 失败时不删除任务, 由调用方处理(任务还被其他对象引用时使用)
+	ScheduleError post(const uint32_t index, Task* c, const TaskPriority priority = PRIORITY_NORMAL);
+
+	//延时任务: |ms|毫秒后在hashkey对应的子线程执行一次, 精度为Countdown::TIME_CLICK
+	//返回的句柄可在任意线程取消, 投递失败返回无效句柄
+	TimerHandle scheduleAfter(const uint32_t hashkey, const int ms, Task* c);
+	template<typename ARG>
+	TimerHandle scheduleAfter(const uint32_t hashkey, const int ms, void(*fun)(const ARG& req), const ARG& req, const TaskName& name="timer")
+	{
+		return scheduleTimer(hashkey, new TimerExecutor<void,ARG>(fun, req, ms, 0, name));
+	}
+	template<typename OBJ,typename ARG>
+	TimerHandle scheduleAfter(const uint32_t hashkey, const int ms, OBJ* obj, void(OBJ::*fun)(const ARG& req), const ARG& req, const TaskName& name="timer")
+	{
+		return scheduleTimer(hashkey, new TimerExecutor<OBJ,ARG>(obj, fun, req, ms, 0, name));
+	}
+
+	//周期任务: 每|ms|毫秒在hashkey对应的子线程执行一次, 直到取消
+	TimerHandle scheduleEvery(const uint32_t hashkey, const int ms, Task* c);
+	template<typename ARG>
+	TimerHandle scheduleEvery(const uint32_t hashkey, const int ms, void(*fun)(const ARG& req), const ARG& req, const TaskName& name="timer")
+	{
+		return scheduleTimer(hashkey, new TimerExecutor<void,ARG>(fun, req, ms, ms, name));
 	}
+	template<typename OBJ,typename ARG>
+	TimerHandle scheduleEvery(const uint32_t hashkey, const int ms, OBJ* obj, void(OBJ::*fun)(const ARG& req), const ARG& req, const TaskName& name="timer")
+	{
+		return scheduleTimer(hashkey, new TimerExecutor<OBJ,ARG>(obj, fun, req, ms, ms, name));
+	}
+
+	//批量调度: 作用域内当前线程的schedule()按目标线程暂存,
+	//离开最外层作用域或flush()时每个目标线程一次入队, 最多唤醒一次
+	//暂存前按单个任务检查admit(), 拒绝的任务立即失败; 已暂存的任务视为已接受, flush()时不再检查
+	//作用域内的同步等待(Future/LocalFuture/Batch/hedged_call)在等待前先flush(), 不会等待还没投递的任务
+	class BatchScope
+	{
+	public:
+		BatchScope();
+		~BatchScope();
+		void flush();
+	private:
+		BatchScope(const BatchScope&);
+		BatchScope& operator=(const BatchScope&);
+	};
+
+	//提交当前线程暂存的任务
+	void flush();
 
 	//以下两个函数为同步调度
 	template<typename OBJ,typename REQ, typename RSP>
-	bool schedule(const uint32_t hashkey, OBJ* obj, void(OBJ::*fun)(const REQ& req, RSP& rsp), const REQ& req, RSP& rsp, const std::string& name="task")
+	bool schedule(const uint32_t hashkey, OBJ* obj, void(OBJ::*fun)(const REQ& req, RSP& rsp), const REQ& req, RSP& rsp, const TaskName& name="task", const TaskPriority priority=PRIORITY_NORMAL)
 	{
 		net::Condition cond;
 		ExecutorEx<OBJ,REQ,RSP>* c = new ExecutorEx<OBJ,REQ,RSP>(obj, fun, req, rsp, cond, name);
-		if(!schedule(hashkey, c))
+		if(!schedule(hashkey, c, priority))
 			return false;
+		flush();
 		cond.yield();
 		return true;
 	}
 	template<typename REQ, typename RSP>
-	bool schedule(const uint32_t hashkey, void(*fun)(const REQ& req, RSP& rsp), const REQ& req, RSP& rsp, const std::string& name="task")
+	bool schedule(const uint32_t hashkey, void(*fun)(const REQ& req, RSP& rsp), const REQ& req, RSP& rsp, const TaskName& name="task", const TaskPriority priority=PRIORITY_NORMAL)
 	{
 		net::Condition cond;
 		ExecutorEx<void,REQ,RSP>* c = new ExecutorEx<void,REQ,RSP>(fun, req, rsp, cond, name);
-		if(!schedule(hashkey, c))
+		if(!schedule(hashkey, c, priority))
 			return false;
+		flush();
 		cond.yield();
 		return true;
 	}
@@ -78,19 +163,51 @@ public:
 	bool empty() {return _workers.empty();}
 
 	uint32_t getWorkerSize() {return _workers.size();}
+	Worker* getWorker(const uint32_t index) {return index < _workers.size() ? _workers[index] : 0;}
 	pthread_t getWorkerThreadId(const uint32_t hashkey)
 	{
-		if(_workers.empty())
+		if(_workers.size() < 2)
 			return 0;
-		uint32_t index = hashkey % (_workers.size()-1) + 1;
-		Worker* worker = _workers[index];
+		Worker* worker = _workers[route(hashkey)];
 		return worker->getThreadId();
 	}
+	//当前线程是否为连接|connid|所属的IO线程
+	bool isOwnerThread(const uint32_t connid)
+	{
+		return _workers.size() >= 2 && _workers[routeConnection(connid)]->isCurrentThread();
+	}
+
+	//绑定在|cpu|上的子线程, 没有时选同一NUMA节点的子线程, 都没有返回-1
+	int getWorkerByCpu(const int cpu);
+
+	//hashkey在子线程间取模, 不区分是否为连接ID
+	uint32_t route(const uint32_t hashkey) const
+	{
+		return routeHashKey(hashkey, _workers.size());
+	}
+	//连接ID按所属线程路由
+	uint32_t routeConnection(const uint32_t connid) const
+	{
+		return routeConnId(connid, _workers.size());
+	}
 
 	//for quit
 	bool _quit;
 private:
+	//投递定时任务到目标线程挂定时器
+	TimerHandle scheduleTimer(const uint32_t hashkey, TimerTask* c);
+
+	//入队或暂存到|index|号线程, 失败时删除任务
+	bool submit(const uint32_t index, Task* c, const TaskPriority priority);
+	//批量作用域内暂存, 返回false表示不在批量作用域内
+	bool stage(const uint32_t index, Task* c, const TaskPriority priority);
+
 	std::vector<Worker*> _workers;
+	uint32_t _taskBudget;
+	uint32_t _timeBudget;
+	ShedPolicy _policy;
+	uint32_t _target;
+	uint32_t _interval;
 };
 }
 
@@ -0,0 +1,40 @@
+#ifndef __NET_SEND_BUFFER_H__
+#define __NET_SEND_BUFFER_H__
+
+#include "utils/rc.h"
+#include "utils/bytebuffer.h"
+#include "task_pool.h"
+
+namespace net
+{
+//已序列化的待发送数据: 调用线程序列化一次, IO线程只把引用挂到连接的输出链上
+//对象从TaskPool分配(1K以内的数据不再额外分配), 多个连接可以共享同一份(如对冲调用)
+//写满后只读, 引用计数可以跨线程释放
+class SendBuffer : public lin_io::LockedRefCount
+{
+public:
+	SendBuffer() {}
+	virtual ~SendBuffer() {}
+
+	const char* data() const {return _buffer.data();}
+	uint32_t size() const {return (uint32_t)_buffer.size();}
+	bool empty() const {return _buffer.empty();}
+
+	//序列化时写入
+	lin_io::ByteBuffer& buffer() {return _buffer;}
+
+	static void* operator new(size_t size) {return TaskPool::alloc(size);}
+	static void operator delete(void* ptr) {TaskPool::free(ptr);}
+
+private:
+	SendBuffer(const SendBuffer&);
+	SendBuffer& operator=(const SendBuffer&);
+
+private:
+	lin_io::ByteBuffer _buffer;
+};
+
+typedef lin_io::RcVar<SendBuffer> SendBuffervar;
+}
+
+#endif
@@ -82,6 +82,15 @@ int SocketHelper::getrcvbuf() const
     return size;
 }
 
+int SocketHelper::getincomingcpu() const
+{
+    int cpu = -1;
+    socklen_t len = sizeof(cpu);
+    if (!getsockopt(SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len))
+        return -1;
+    return cpu;
+}
+
 void SocketHelper::setsndbuf(int size)
 {
     if (!setsockopt(SOL_SOCKET, SO_SNDBUF, &size, sizeof(size)))
@@ -94,6 +103,19 @@ void SocketHelper::setrcvbuf(int size)
         throw socket_error("setrcvbuf");
 }
 
+void SocketHelper::setudpsegment(int size)
+{
+    if (!setsockopt(SOL_UDP, UDP_SEGMENT, &size, sizeof(size)))
+        throw socket_error("setudpsegment");
+}
+
+void SocketHelper::setudpgro(bool enable)
+{
+    int op = enable ? 1 : 0;
+    if (!setsockopt(SOL_UDP, UDP_GRO, &op, sizeof(op)))
+        throw socket_error("setudpgro");
+}
+
 int SocketHelper::getavailbytes() const
 {
     if (m_sock_flags.tcpserver)
@@ -86,9 +86,14 @@ public:
     void setblocking(bool blocking);
     void setsndbuf(int size);
     void setrcvbuf(int size);
+    // udp offload: 内核按|size|切分发送的数据报(GSO), 合并接收的数据报(GRO)
+    void setudpsegment(int size);
+    void setudpgro(bool enable);
     int getsndbuf() const;
     int getrcvbuf() const;
     int getavailbytes() const;
+    // 最近处理该socket数据的CPU(网卡队列中断所在CPU), 不支持时返回-1
+    int getincomingcpu() const;
 
     std::string getpeerip(int* port = NULL) const { return addr_ntoa(getpeer(port)); }
     std::string getlocalip(int* port = NULL) const { return addr_ntoa(getlocal(port)); }
@@ -141,6 +146,9 @@ public:
     // <0 : error (reserve)
     //    : throw socket_error
     int recvfrom(void* buf, size_t len, ipaddr_type* from, socklen_t* fromlen);
+    // >=0 : bytes recv, |segment| is the size of coalesced datagrams(0 : not coalesced)
+    //     : throw socket_error
+    int recvsegments(char* buf, const int len, int* segment);
 
     // >=0 : accepted socket
     // <0  : some error can ignore. for accept more than once
@@ -360,6 +368,42 @@ inline int SocketHelper::recvfrom(void* buf, size_t len, ipaddr_type* from, sock
     return ret;
 }
 
+inline int SocketHelper::recvsegments(char* buf, const int len, int* segment)
+{
+    m_sock_flags.recv_tag = 1;
+
+    char control[CMSG_SPACE(sizeof(int))];
+    struct iovec iov;
+    iov.iov_base = buf;
+    iov.iov_len = len;
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    *segment = 0;
+    int ret = ::recvmsg(getsocket(), &msg, 0);
+    if (SOCKET_ERROR == ret) {
+        int en = socket_error::getLastError();
+        if (isIgnoreError(en))
+            return 0;
+        throw socket_error(en, "recvmsg");
+    }
+
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+        {
+            memcpy(segment, CMSG_DATA(cmsg), sizeof(int));
+            break;
+        }
+    }
+    return ret;
+}
+
 inline void SocketHelper::socket(int type)
 {
     m_socket = ::socket(AF_INET, type, 0);
@@ -398,6 +442,16 @@ inline SOCKET SocketHelper::accept(u_long* addr, int* port)
         *port = ntohs(sa.sin_port);
     return ret;
 }
+
+// 最近处理socket |s| 数据的CPU, 不支持时返回-1
+inline int getIncomingCpu(const SOCKET s)
+{
+    SocketHelper so;
+    so.attach(s);
+    int cpu = so.getincomingcpu();
+    so.detach();
+    return cpu;
+}
 }
 
 #endif
@@ -38,6 +38,21 @@ typedef int SOCKET;
 // see: setnodelay()
 #include <netinet/tcp.h>
 
+// see: setudpsegment(), setudpgro()
+#include <netinet/udp.h>
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+#ifndef SO_INCOMING_CPU
+#define SO_INCOMING_CPU 49
+#endif
+
 #endif
 
 #endif // _SNOX_SOCKINC_H_INCLUDE__
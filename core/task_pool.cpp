@@ -0,0 +1,160 @@
+#include "task_pool.h"
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+
+using namespace net;
+
+namespace
+{
+struct Cache;
+
+struct Block
+{
+	Cache*   owner;//为空表示超过最大分级, 直接malloc
+	uint32_t cls;
+	uint32_t pad;
+	Block*   next;//空闲时的链接, 占用负载区
+};
+
+struct Cache
+{
+	Cache():exited(false)
+	{
+		for(int i = 0; i < TaskPool::CLASS_COUNT; i++)
+		{
+			local[i] = 0;
+			remote[i] = 0;
+		}
+	}
+
+	Block* local[TaskPool::CLASS_COUNT];//本线程使用
+	std::atomic<Block*> remote[TaskPool::CLASS_COUNT];//其他线程归还
+	std::atomic<bool> exited;
+};
+
+void freeList(Block* b)
+{
+	while(b)
+	{
+		Block* next = b->next;
+		::free(b);
+		b = next;
+	}
+}
+
+//线程退出时释放缓存; Cache本身不释放, 在途的块仍可能引用它
+struct CacheHolder
+{
+	CacheHolder():cache(0) {}
+	~CacheHolder()
+	{
+		if(!cache)
+			return;
+		//先置exited再取走链表, 之后归还的块由TaskPool::free自行释放
+		cache->exited.store(true);
+		for(int i = 0; i < TaskPool::CLASS_COUNT; i++)
+		{
+			freeList(cache->local[i]);
+			cache->local[i] = 0;
+			freeList(cache->remote[i].exchange(0));
+		}
+	}
+	Cache* cache;
+};
+
+Cache* localCache()
+{
+	static thread_local CacheHolder holder;
+	if(!holder.cache)
+		holder.cache = new Cache;
+	return holder.cache;
+}
+
+int classOf(const size_t total)
+{
+	size_t blockSize = TaskPool::MIN_BLOCK_SIZE;
+	for(int cls = 0; cls < TaskPool::CLASS_COUNT; cls++, blockSize <<= 1)
+	{
+		if(total <= blockSize)
+			return cls;
+	}
+	return -1;
+}
+
+inline void* payload(Block* b)
+{
+	return (char*)b + TaskPool::HEADER_SIZE;
+}
+}
+
+void* TaskPool::alloc(const size_t size)
+{
+	const size_t total = size + HEADER_SIZE;
+	const int cls = classOf(total);
+	if(cls < 0)
+	{
+		Block* b = (Block*)::malloc(total);
+		if(!b)
+			throw std::bad_alloc();
+		b->owner = 0;
+		b->cls = CLASS_COUNT;
+		return payload(b);
+	}
+
+	Cache* cache = localCache();
+	Block* b = cache->local[cls];
+	if(!b)
+	{
+		b = cache->remote[cls].exchange(0, std::memory_order_acquire);
+	}
+	if(b)
+	{
+		cache->local[cls] = b->next;
+		return payload(b);
+	}
+
+	b = (Block*)::malloc((size_t)MIN_BLOCK_SIZE << cls);
+	if(!b)
+		throw std::bad_alloc();
+	b->owner = cache;
+	b->cls = cls;
+	return payload(b);
+}
+
+void TaskPool::free(void* ptr)
+{
+	if(!ptr)
+		return;
+
+	Block* b = (Block*)((char*)ptr - HEADER_SIZE);
+	Cache* owner = b->owner;
+	if(!owner)
+	{
+		::free(b);
+		return;
+	}
+
+	if(owner == localCache())
+	{
+		b->next = owner->local[b->cls];
+		owner->local[b->cls] = b;
+		return;
+	}
+
+	if(owner->exited.load())
+	{
+		::free(b);
+		return;
+	}
+
+	//归还到分配线程: 只有push和整体取走, 没有ABA问题
+	std::atomic<Block*>& head = owner->remote[b->cls];
+	b->next = head.load(std::memory_order_relaxed);
+	while(!head.compare_exchange_weak(b->next, b, std::memory_order_seq_cst, std::memory_order_relaxed));
+
+	//检查exited与push之间分配线程可能已退出并取走链表, push后再检查一次, 由本线程释放剩余的块
+	//与~CacheHolder先置exited再取链表构成seq_cst顺序, 两边至少有一方能看到对方, 块不会泄漏
+	if(owner->exited.load())
+		freeList(head.exchange(0));
+}
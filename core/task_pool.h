@@ -0,0 +1,28 @@
+#ifndef __NET_TASK_POOL_H__
+#define __NET_TASK_POOL_H__
+
+#include <stddef.h>
+#include "utils/int_types.h"
+
+namespace net
+{
+//任务对象内存池: 按大小分级, 每个线程一份空闲链表
+//任务通常在生产线程分配、在IO线程释放, 释放时归还到分配线程的回收链表(无锁),
+//分配线程本地链表为空时一次取回; 稳定运行后调度任务不再调用malloc
+//每个线程缓存的块数不超过该线程同时在途的任务数
+class TaskPool
+{
+public:
+	enum
+	{
+		CLASS_COUNT = 6,      //64, 128, 256, 512, 1024, 2048字节(包括块头), 后两级用于SendBuffer
+		MIN_BLOCK_SIZE = 64,
+		HEADER_SIZE = 16,     //保持16字节对齐
+	};
+
+	static void* alloc(const size_t size);
+	static void free(void* ptr);
+};
+}
+
+#endif
@@ -84,6 +84,8 @@ TcpConnection::TcpConnection(const SOCKET so, const uint32_t ip, const int port,
 , _recvBytes(0)
 , _manager(manager)
 , _handler(handler)
+, _chainOffset(0)
+, _chainBytes(0)
 {
 	try
 	{
@@ -121,6 +123,8 @@ TcpConnection::TcpConnection(const std::string& host, const int port, uint32_t i
 , _recvBytes(0)
 , _manager(manager)
 , _handler(handler)
+, _chainOffset(0)
+, _chainBytes(0)
 {
 	try
 	{
@@ -154,6 +158,8 @@ TcpConnection::TcpConnection(const uint32_t ip, const int port, const uint32_t i
 , _recvBytes(0)
 , _manager(manager)
 , _handler(handler)
+, _chainOffset(0)
+, _chainBytes(0)
 {
 	try
 	{
@@ -235,6 +241,53 @@ SOCKET TcpConnection::getSocket()
     return socket().getsocket();
 }
 
+bool TcpConnection::detach()
+{
+	if(_status != ESTABLISHED || !socket().isConnected())
+	{
+		GLWARN << "connection is not established, can not migrate " << dump();
+		return false;
+	}
+	if(hasPinnedFutures())
+	{
+		GLWARN << "connection has coroutine calls in flight, can not migrate " << dump();
+		return false;
+	}
+
+	select_timeout();
+	Socket::remove();
+	//在新的Selector上重新注册所有事件
+	socket().m_sock_flags.selevent = 0;
+	detachFutures();
+	return true;
+}
+
+bool TcpConnection::attach(const uint32_t connid, ILinkCtrlHandler* manager)
+{
+	_connId = connid;
+	_manager = manager;
+	_info.clear();
+	try
+	{
+		int add = SEL_READ;
+		if(!_output.empty() || !_chain.empty())
+			add |= SEL_WRITE;
+		select(0, add);
+		if(_timeout > 0)
+		{
+			select_timeout(_timeout);
+		}
+	}
+	catch (const std::exception& e)
+	{
+		GLWARN << "attach " << e.what() << " on connection " << dump();
+		handleOnClose(e.what());
+		return false;
+	}
+	attachFutures(connid);
+	return true;
+}
+
 void TcpConnection::close()
 {
 	handleOnInitiativeClose("close");
@@ -255,6 +308,14 @@ void TcpConnection::setBufferSize(int wbuf, int rbuf)
 
 uint32_t TcpConnection::send(const char* data, const uint32_t size) throw_exceptions
 {
+	//输出链不为空时追加到链尾, 保证发送顺序
+	if(!_chain.empty() && data && size > 0)
+	{
+		SendBuffervar buffer(new SendBuffer());
+		buffer->buffer().write(data, size);
+		return send(buffer.ptr());
+	}
+
 	int n(0);
     if (socket().isConnected() && _output.empty())
     {
@@ -275,20 +336,77 @@ uint32_t TcpConnection::send(const char* data, const uint32_t size) throw_except
     _sendBytes += size;
     _sentBytes += n>0?n:0;
 
-    return (uint32_t)_output.size();
+    return pending();
+}
+
+uint32_t TcpConnection::send(SendBuffer* buffer) throw_exceptions
+{
+	const uint32_t size = buffer->size();
+	int n(0);
+	if (socket().isConnected() && _output.empty() && _chain.empty())
+	{
+		n = socket().send(buffer->data(), (int)size);
+		if (n < (int)size)
+		{
+			//剩余部分只保留引用, 不拷贝
+			_chain.push_back(SendBuffervar(buffer));
+			_chainOffset = n;
+			_chainBytes = size - n;
+			select(0, SEL_WRITE);
+		}
+	}
+	else if (size > 0)
+	{
+		if (_output.size() + _chainBytes + size > _output.limit())
+			throw lin_io::ResourceLimitException("buffer overflow");
+		_chain.push_back(SendBuffervar(buffer));
+		_chainBytes += size;
+	}
+
+	_lastSendTs = time(NULL);
+	_sendBytes += size;
+	_sentBytes += n>0?n:0;
+
+	return pending();
+}
+
+uint32_t TcpConnection::pending() const
+{
+	return (uint32_t)(_output.size() + _chainBytes);
 }
 
 bool TcpConnection::flush() throw_exceptions
 {
-    if(_output.empty())
+    if(_output.empty() && _chain.empty())
         return true;
-    int n = socket().send(_output.data(), (int)_output.size());
-    if(n > 0)
-        _output.erase(n);
-    if(_output.empty())
+    if(!_output.empty())
+    {
+        int n = socket().send(_output.data(), (int)_output.size());
+        if(n > 0)
+            _output.erase(n);
+        _sentBytes += n>0?n:0;
+    }
+    //先发完output再发输出链
+    while(_output.empty() && !_chain.empty())
+    {
+        SendBuffer* buffer = _chain.front().ptr();
+        const int left = (int)(buffer->size() - _chainOffset);
+        int n = socket().send(buffer->data() + _chainOffset, left);
+        if(n <= 0)
+            break;
+        _sentBytes += n;
+        _chainBytes -= n;
+        if(n < left)
+        {
+            _chainOffset += n;
+            break;
+        }
+        _chain.pop_front();
+        _chainOffset = 0;
+    }
+    if(_output.empty() && _chain.empty())
         select(SEL_WRITE, 0);
-    _sentBytes += n>0?n:0;
-    return _output.empty();
+    return _output.empty() && _chain.empty();
 }
 
 void TcpConnection::onConnected(const std::string& desc)
@@ -356,16 +474,43 @@ void TcpConnection::onRead()
     }
 
     int ret = handleOnData();
-    if(ret >= 0)
-    {
-        _input.erase(ret);
-    }
-    else
+    consume(ret);
+    if(ret < 0)
     {
     	handleOnInitiativeClose("handle data happen error");
     }
 }
 
+RecvSlice* TcpConnection::slice(const char* data, const uint32_t size)
+{
+	//内部缓冲区移交时会搬移数据, 小数据直接拷贝
+	if(_input.inlined() || data < _input.data() || data + size > _input.data() + _input.size())
+		return RecvSlice::copy(data, size);
+
+	if(!_block.ptr())
+		_block = new RecvBlock();
+	return new RecvSlice(_block.ptr(), data, size);
+}
+
+void TcpConnection::consume(const int ret)
+{
+	if(!_block.ptr())
+	{
+		if(ret >= 0)
+			_input.erase(ret);
+		return;
+	}
+
+	//存储交给切片(数据不移动), 只把未处理的部分写回输入缓冲区
+	const size_t used = ret >= 0 ? std::min((size_t)ret, _input.size()) : _input.size();
+	const char* rest = _input.data() + used;
+	const size_t left = _input.size() - used;
+	_block->adopt(_input.release());
+	if(left > 0)
+		_input.write(rest, left);
+	_block = (RecvBlock*)0;
+}
+
 void TcpConnection::onWrite()
 {
 	lin_io::RcVar<TcpConnection> ref(this);
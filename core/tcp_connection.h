@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <cstring>
 #include <stdarg.h>
+#include <deque>
 #include "utils/rc.h"
 #include "utils/utility.h"
 #include "utils/bytebuffer.h"
@@ -30,7 +31,7 @@ public:
     }
     void doConnect(const std::string& ip, const int port, const int timo)
     {
-        doConnect(lin_io::aton_addr(ip), port, timo);
+        doConnect(aton_addr(ip), port, timo);
     }
     void doConnect(const u_long ip, const int port, const int timo)
     {
@@ -94,6 +95,12 @@ public:
     // 可用send(0,0)来返回当前output buffer size
     // 网络连接断开或Connection的输出缓冲满，抛出异常
     virtual uint32_t send(const char* data, const uint32_t sz) throw_exceptions;
+    // 只保留|buffer|的引用, 发不完的部分挂在输出链上
+    virtual uint32_t send(SendBuffer* buffer) throw_exceptions;
+    // 还没有发出的字节数(output buffer + 输出链)
+    uint32_t pending() const;
+    // 输入缓冲区在堆上时只引用不拷贝: 本轮onData结束后把存储移交给切片, 未处理的数据搬到新缓冲区
+    virtual RecvSlice* slice(const char* data, const uint32_t size);
 
     //获取和设置接收超时时间
     virtual int getKeepaliveTimeout() {return _timeout;}
@@ -104,11 +111,17 @@ public:
     void setBufferSize(const int wbuf, const int rbuf);
 
     //for some performence optimizing, for example: can serialize message to output dirctly
+    //输出链不为空(pending() > output().size())时直接写output会乱序
     InputBuffer& input() { return _input; }
     OutputBuffer& output() { return _output; }
 
     time_t getLastSendTime() {return _lastSendTs;}
     time_t getLastRecvTime() {return _lastRecvTs;}
+
+    //连接迁移: 在原IO线程从Selector注销并停止定时器, 缓冲区和等待中的future随对象一起转移
+    bool detach();
+    //在目标IO线程使用新连接ID重新注册, 失败时关闭连接
+    bool attach(const uint32_t connid, ILinkCtrlHandler* manager);
 protected:
     bool flush() throw_exceptions;
 
@@ -120,6 +133,8 @@ protected:
 
 protected:
     int handleOnData() throw();
+    //onData之后: 有切片时移交输入存储, 否则删除已处理的数据
+    void consume(const int ret);
     bool handleOnConnected() throw();
     bool handleOnClose(const char* reason) throw();
     bool handleOnInitiativeClose(const char* reason) throw();
@@ -132,7 +147,7 @@ protected:
     int _localPort;
     int _timeout;
 
-    const uint32_t _connId;
+    uint32_t _connId;
     Status _status;
     time_t _lastRecvTs;
     time_t _lastSendTs;
@@ -149,6 +164,12 @@ protected:
 
     InputBuffer _input;
     OutputBuffer _output;
+    //output之后待发送的已序列化数据, 只持有引用
+    std::deque<SendBuffervar> _chain;
+    uint32_t _chainOffset;//链头已发送的字节数
+    size_t _chainBytes;   //链上未发送的字节数
+    //本轮onData中被切片引用的输入存储, onData返回后移交
+    RecvBlockvar _block;
     mutable std::string _info;
 };
 
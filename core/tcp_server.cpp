@@ -34,6 +34,16 @@ void TcpServer::onAccept(IListener* listener, const SOCKET s, const uint32_t cli
     {
     	hashKey = *serverContext->hashKey.get();
     }
+    else
+    {
+    	//IO线程绑核时, 放到网卡队列中断CPU附近的线程
+    	int index = Scheduler::instance().getWorkerByCpu(getIncomingCpu(s));
+    	if(index > 0)
+    	{
+    		Scheduler::instance().scheduleTo(index, TcpServer::doAccept, context);
+    		return;
+    	}
+    }
 
 	Scheduler::instance().schedule(hashKey, TcpServer::doAccept, context);
 }
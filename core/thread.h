@@ -58,6 +58,11 @@ class Condition : public Mutex
        gettimeofday(&now, NULL);
        ts.tv_sec = now.tv_sec + ms / 1000;
        ts.tv_nsec = ( now.tv_usec + ms%1000 * 1000 ) * 1000;
+       if( ts.tv_nsec >= 1000000000 )
+       {
+         ts.tv_sec += 1;
+         ts.tv_nsec -= 1000000000;
+       }
        r = pthread_cond_timedwait(&_cond,&_mutex,&ts);
      }
      return !r ;
@@ -0,0 +1,97 @@
+#include "timer_task.h"
+#include "scheduler.h"
+#include "log/logger.h"
+
+using namespace net;
+
+bool TimerTask::run()
+{
+	//所有引用都已释放, 由Worker删除
+	if(_refs.load() == 0)
+		return false;
+
+	int state = STATE_PENDING;
+	if(_state.compare_exchange_strong(state, STATE_ARMED))
+	{
+		select_timeout(_delay);
+		return true;
+	}
+
+	if(state == STATE_CANCELLING)
+	{
+		close_timeout();
+		_state.store(STATE_DONE);
+	}
+	return !finish();
+}
+
+void TimerTask::handle(const int ev)
+{
+	//已取消, 由取消任务清理
+	if(_state.load() != STATE_ARMED)
+		return;
+
+	try
+	{
+		fire();
+	}
+	catch(const std::exception& e)
+	{
+		GLERROR << "timer task name: " << _name << " happen error: " << e.what();
+	}
+	catch(...)
+	{
+		GLERROR << "timer task name: " << _name << " happen error";
+	}
+
+	if(_interval > 0 && _state.load() == STATE_ARMED)
+	{
+		select_timeout(_interval);
+		return;
+	}
+
+	int state = STATE_ARMED;
+	if(_state.compare_exchange_strong(state, STATE_DONE) && finish())
+	{
+		delete this;
+	}
+}
+
+void TimerTask::cancel()
+{
+	//还在队列中: 直接标记, 所属线程取出后丢弃
+	int state = STATE_PENDING;
+	if(_state.compare_exchange_strong(state, STATE_DONE))
+		return;
+	if(state != STATE_ARMED)
+		return;
+
+	//已挂定时器: 回到所属线程摘除
+	//投递失败(正在退出)时不能删除: 定时器还挂在所属线程上, 到期时按已取消处理, 不再执行
+	if(_state.compare_exchange_strong(state, STATE_CANCELLING))
+	{
+		ScheduleError err = Scheduler::instance().post(_index, this, PRIORITY_URGENT);
+		if(err != SCHEDULE_OK && err != SCHEDULE_QUIT)
+		{
+			GLWARN << "timer task name: " << _name << " cancel not delivered: " << err;
+		}
+	}
+}
+
+void TimerTask::release()
+{
+	if(_refs.fetch_sub(1) != 1)
+		return;
+	//所属线程已经结束, 回到所属线程删除
+	//投递失败时不在当前线程删除(Handler析构要操作所属线程的Selector), 留给进程退出回收
+	ScheduleError err = Scheduler::instance().post(_index, this, PRIORITY_URGENT);
+	if(err != SCHEDULE_OK && err != SCHEDULE_QUIT)
+	{
+		GLWARN << "timer task name: " << _name << " release not delivered: " << err;
+	}
+}
+
+bool TimerTask::finish()
+{
+	return _refs.fetch_sub(1) == 1;
+}
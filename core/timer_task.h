@@ -0,0 +1,161 @@
+#ifndef __NET_TIMER_TASK_H__
+#define __NET_TIMER_TASK_H__
+
+#include <atomic>
+#include "worker.h"
+#include "handler.h"
+
+namespace net
+{
+//延时/周期任务: 作为普通任务投递到目标IO线程, 在该线程的Countdown上挂定时器
+//对象本身从TaskPool分配, 挂定时器和取消都不再分配内存
+//只在所属IO线程上删除(Handler析构要操作本线程的Selector)
+class TimerTask : public Task, public Handler
+{
+	friend class Scheduler;
+	friend class TimerHandle;
+public:
+	enum State
+	{
+		STATE_PENDING = 0,    //在队列中, 还没有挂定时器
+		STATE_ARMED = 1,      //已挂定时器
+		STATE_CANCELLING = 2, //已取消, 等待所属线程摘除定时器
+		STATE_DONE = 3,
+	};
+
+	//|interval| > 0为周期任务
+	TimerTask(const int delay, const int interval, const TaskName& name)
+	:_index(0), _delay(delay), _interval(interval), _name(name.c_str()), _state(STATE_PENDING), _refs(1)
+	{
+	}
+	virtual ~TimerTask() {}
+
+	//所属IO线程执行: 挂定时器/摘除定时器/删除
+	virtual bool run();
+	virtual const char* name() {return _name;}
+
+protected:
+	//定时器到期, 在所属IO线程执行
+	virtual void fire() = 0;
+
+private:
+	virtual void handle(const int ev);
+
+	//任意线程调用
+	void cancel();
+	void retain() {_refs.fetch_add(1);}
+	void release();
+	//所属IO线程释放自己的引用, 返回true表示需要删除
+	bool finish();
+
+private:
+	uint32_t _index;//所属线程序号
+	int _delay;
+	int _interval;
+	const char* _name;
+	std::atomic<int> _state;
+	std::atomic<int> _refs;//所属线程一份, 每个TimerHandle一份
+};
+
+//取消句柄, 可以在任意线程取消; 句柄释放不影响定时器执行
+class TimerHandle
+{
+	friend class Scheduler;
+public:
+	TimerHandle():_task(0) {}
+	TimerHandle(const TimerHandle& o):_task(o._task)
+	{
+		if(_task)
+			_task->retain();
+	}
+	~TimerHandle()
+	{
+		reset();
+	}
+	TimerHandle& operator=(const TimerHandle& o)
+	{
+		if(o._task)
+			o._task->retain();
+		reset();
+		_task = o._task;
+		return *this;
+	}
+
+	bool valid() const {return _task != 0;}
+	//是否还会执行(一次性任务执行后为false)
+	bool pending() const
+	{
+		if(!_task)
+			return false;
+		int state = _task->_state.load();
+		return state == TimerTask::STATE_PENDING || state == TimerTask::STATE_ARMED;
+	}
+	//取消后不再执行, 已经开始的本次回调不受影响
+	void cancel()
+	{
+		if(_task)
+			_task->cancel();
+	}
+	void reset()
+	{
+		if(_task)
+		{
+			_task->release();
+			_task = 0;
+		}
+	}
+
+private:
+	//接管调度时预留的引用
+	explicit TimerHandle(TimerTask* task):_task(task) {}
+	TimerTask* _task;
+};
+
+//包装普通任务: 每次到期调用一次run(), 返回值忽略, 定时器结束后删除
+class TaskTimer : public TimerTask
+{
+public:
+	TaskTimer(Task* c, const int delay, const int interval)
+	:TimerTask(delay, interval, c->name()), _task(c)
+	{
+	}
+	virtual ~TaskTimer() {delete _task;}
+protected:
+	virtual void fire() {_task->run();}
+private:
+	Task* _task;
+};
+
+template<typename OBJ,typename ARG>
+class TimerExecutor : public TimerTask
+{
+public:
+	TimerExecutor(OBJ* obj, void(OBJ::*fun)(const ARG& req), const ARG& req, const int delay, const int interval, const TaskName& name="timer")
+	:TimerTask(delay, interval, name),_obj(obj),_fun(fun),_req(req)
+	{
+	}
+protected:
+	virtual void fire() {(_obj->*_fun)(_req);}
+private:
+	OBJ* _obj;
+	void(OBJ::*_fun)(const ARG& req);
+	ARG _req;
+};
+
+template<typename ARG>
+class TimerExecutor<void,ARG> : public TimerTask
+{
+public:
+	TimerExecutor(void(*fun)(const ARG& req), const ARG& req, const int delay, const int interval, const TaskName& name="timer")
+	:TimerTask(delay, interval, name),_fun(fun),_req(req)
+	{
+	}
+protected:
+	virtual void fire() {(*_fun)(_req);}
+private:
+	void(*_fun)(const ARG& req);
+	ARG _req;
+};
+}
+
+#endif
@@ -16,10 +16,10 @@ UdpClient::~UdpClient()
 
 bool UdpClient::create(const IClientContext_var& context)
 {
-	return create(context->peerIP, context->peerPort, context->handler.ptr());
+	return create(context->peerIP, context->peerPort, context->handler.ptr(), context->arq.get());
 }
 
-bool UdpClient::create(const std::string& host, const int port, IClientHandler* handler)
+bool UdpClient::create(const std::string& host, const int port, IClientHandler* handler, const ArqConfig* arq)
 {
 	if(!handler)
 	{
@@ -27,7 +27,7 @@ bool UdpClient::create(const std::string& host, const int port, IClientHandler*
 		return false;
 	}
 
-	if(0 == net::Manager::get()->createUdpClient(host, port, handler))
+	if(0 == net::Manager::get()->createUdpClient(host, port, handler, arq))
 	{
 		return false;
 	}
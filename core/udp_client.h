@@ -17,7 +17,7 @@ public:
 
 public:
 	static bool create(const IClientContext_var& context);
-    static bool create(const std::string& host, const int port, IClientHandler* handler);
+    static bool create(const std::string& host, const int port, IClientHandler* handler, const ArqConfig* arq = 0);
     static bool remove(const uint32_t connId);
 
 public:
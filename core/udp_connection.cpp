@@ -86,6 +86,10 @@ UdpConnection::UdpConnection(const SOCKET so, const uint32_t ip, const int port,
 , _manager(manager)
 , _handler(handler)
 , _listener(listener)
+, _segmentSize(0)
+, _gso(false)
+, _gro(false)
+, _arqTimer(this, &UdpConnection::onArqTimer)
 {
 	try
 	{
@@ -122,6 +126,10 @@ UdpConnection::UdpConnection(const std::string& host, const int port, const uint
 , _recvBytes(0)
 , _manager(manager)
 , _handler(handler)
+, _segmentSize(0)
+, _gso(false)
+, _gro(false)
+, _arqTimer(this, &UdpConnection::onArqTimer)
 {
 	try
 	{
@@ -152,6 +160,10 @@ UdpConnection::UdpConnection(const uint32_t ip, const int port, const uint32_t i
 , _recvBytes(0)
 , _manager(manager)
 , _handler(handler)
+, _segmentSize(0)
+, _gso(false)
+, _gro(false)
+, _arqTimer(this, &UdpConnection::onArqTimer)
 {
 	try
 	{
@@ -167,6 +179,7 @@ UdpConnection::UdpConnection(const uint32_t ip, const int port, const uint32_t i
 
 UdpConnection::~UdpConnection()
 {
+	_arqTimer.stop();
     if(_listener.ptr())
     {
     	GLINFO << "listener remove " << addr_ntoa(_peerIp) << ":" << _peerPort;
@@ -252,17 +265,119 @@ void UdpConnection::setBufferSize(int wbuf, int rbuf)
     }
 }
 
+bool UdpConnection::setSegmentation(const uint16_t segment, const bool gro)
+{
+	try
+	{
+		if(segment > 0 || _gso)
+		{
+			socket().setudpsegment(segment);
+		}
+		_gso = segment > 0;
+	}
+	catch(const std::exception& e)
+	{
+		_gso = false;
+		GLWARN << "udp gso unsupported, segment in user space: " << e.what() << " " << dump();
+	}
+	_segmentSize = segment;
+
+	try
+	{
+		if(gro || _gro)
+		{
+			socket().setudpgro(gro);
+		}
+		_gro = gro;
+	}
+	catch(const std::exception& e)
+	{
+		_gro = false;
+		GLWARN << "udp gro unsupported: " << e.what() << " " << dump();
+	}
+
+	GLINFO << "udp segment: " << segment << " gso: " << _gso << " gro: " << _gro << " " << dump();
+	return _gso;
+}
+
+//按分段大小发送, 返回已发送的字节数(发送缓冲满时只发送了部分分段)
+int UdpConnection::sendSegments(const char* data, const uint32_t size) throw_exceptions
+{
+	uint32_t batch = _segmentSize;
+	if(_gso)
+	{
+		batch *= std::min((uint32_t)UDP_MAX_SEGMENTS, std::max((uint32_t)UDP_MAX_GSO_BYTES / _segmentSize, (uint32_t)1));
+	}
+
+	uint32_t offset = 0;
+	while(offset < size)
+	{
+		uint32_t len = std::min(size - offset, batch);
+		if(socket().send(data + offset, (int)len) <= 0)
+		{
+			break;
+		}
+		offset += len;
+	}
+	return (int)offset;
+}
+
+void UdpConnection::setArq(const ArqConfig& config)
+{
+	if(_segmentSize > 0)
+	{
+		setSegmentation(0, _gro);
+	}
+	_arq = new ArqSession(config, this);
+	_arqTimer.start(_arq->getInterval());
+	GLINFO << "arq mtu: " << config.mtu << " interval: " << config.interval << " min rto: " << config.minRto
+			<< " window: " << config.sndWnd << "/" << config.rcvWnd << " fast resend: " << config.fastResend << " " << dump();
+}
+
 uint32_t UdpConnection::send(const char* data, const uint32_t size) throw_exceptions
+{
+	if(!_arq.ptr())
+	{
+		return sendDatagram(data, size);
+	}
+
+	if(data && size > 0)
+	{
+		_arq->send(data, size);
+		_arq->update((uint32_t)Selector::me()->tick());
+		_lastSendTs = time(NULL);
+		_sendBytes += size;
+	}
+	return _arq->waitSend();
+}
+
+void UdpConnection::output(const char* data, const uint32_t size)
+{
+	sendDatagram(data, size);
+}
+
+void UdpConnection::onArqTimer()
+{
+	lin_io::RcVar<UdpConnection> ref(this);
+	if(!_arq->update((uint32_t)Selector::me()->tick()))
+	{
+		handleOnClose("arq dead link");
+		return;
+	}
+	_arqTimer.start(_arq->getInterval());
+}
+
+uint32_t UdpConnection::sendDatagram(const char* data, const uint32_t size) throw_exceptions
 { 
 	try
 	{
     if(socket().isConnected() && _output.empty())
     {
     	//if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) return UV_EAGAIN;//return en == EAGAIN || en == EINTR || EINPROGRESS == en;
-    	int n = socket().send(data, (int)size);
-        if(n == 0)
+    	int n = _segmentSize > 0 ? sendSegments(data, size) : socket().send(data, (int)size);
+        if(n == 0 || (_segmentSize > 0 && n < (int)size))
         {
-            _output.push_back(std::string(data, size));
+            _output.push_back(std::string(data + n, size - n));
             select(0, SEL_WRITE);
         }
         else if(n < (int)size)
@@ -276,8 +391,11 @@ uint32_t UdpConnection::send(const char* data, const uint32_t size) throw_except
         if(data && size > 0)
         	_output.push_back(std::string(data, size));
     }
-    _lastSendTs = time(NULL);
-    _sendBytes += size;
+    if(!_arq.ptr())
+    {
+    	_lastSendTs = time(NULL);
+    	_sendBytes += size;
+    }
 
 	}
     catch(const std::exception& e)
@@ -292,16 +410,22 @@ bool UdpConnection::flush() throw_exceptions
 {
     while(!_output.empty())
     {
-    	std::string data = _output.front();
-        int n = socket().send(data.data(), (int)data.size());
+    	std::string& data = _output.front();
+        int n = _segmentSize > 0 ? sendSegments(data.data(), (uint32_t)data.size()) : socket().send(data.data(), (int)data.size());
 
         if(n == 0)
             break;
-        else if(n < (int)data.size())
-        	GLERROR << "just " << n << " of " << data.size() << " bytes were sent";
 
         _sentBytes += n>0?n:0;
 
+        if(_segmentSize > 0 && n < (int)data.size())
+        {
+            data.erase(0, n);
+            break;
+        }
+        else if(n < (int)data.size())
+        	GLERROR << "just " << n << " of " << data.size() << " bytes were sent";
+
         _output.pop_front();
         if(_output.empty())
         {
@@ -345,6 +469,12 @@ void UdpConnection::onRead()
 	lin_io::RcVar<UdpConnection> ref(this);
     _lastRecvTs = time(NULL);
 
+    if(_gro || _arq.ptr())
+    {
+    	onReadDatagrams();
+    	return;
+    }
+
     try
     {
         SOCKET s = socket().getsocket();
@@ -382,6 +512,125 @@ void UdpConnection::onRead()
     }
 }
 
+//接收数据报: 内核合并的数据报按分段大小拆分后逐个处理, 可靠传输时先经过ARQ会话
+void UdpConnection::onReadDatagrams()
+{
+	static thread_local char buf[UDP_MAX_GRO_BYTES];
+
+	int readBytes(0), segment(0);
+	try
+	{
+		if(_gro)
+		{
+			readBytes = socket().recvsegments(buf, (int)sizeof(buf), &segment);
+		}
+		else
+		{
+			readBytes = socket().recv(buf, (int)sizeof(buf));
+		}
+	}
+	catch(socket_error& e)
+	{
+		GLWARN << "read " << e.what() << " on connection " << dump();
+		return;
+	}
+	if(readBytes <= 0)
+	{
+		return;
+	}
+	_recvBytes += readBytes;
+	if(segment <= 0)
+	{
+		segment = readBytes;
+	}
+
+	for(int offset = 0; offset < readBytes; offset += segment)
+	{
+		uint32_t len = (uint32_t)std::min(segment, readBytes - offset);
+		if(_arq.ptr())
+		{
+			if(!onArqDatagram(buf + offset, len))
+				return;
+			continue;
+		}
+
+		try
+		{
+			_input.write(buf + offset, len);
+			*_input.reserve(1) = 0;
+		}
+		catch(const lin_io::ResourceLimitException&)
+		{
+			GLWARN << "read input buffer no space on connection " << dump();
+			handleOnClose("input buffer no space");
+			return;
+		}
+		if(!deliver())
+			return;
+	}
+
+	//尽快回复ACK
+	if(_arq.ptr())
+	{
+		_arq->update((uint32_t)Selector::me()->tick());
+	}
+}
+
+void UdpConnection::onDatagram(const char* data, const uint32_t size)
+{
+	if(!_arq.ptr())
+	{
+		_handler->onData(data, size, this);
+		return;
+	}
+
+	lin_io::RcVar<UdpConnection> ref(this);
+	if(onArqDatagram(data, size))
+	{
+		_arq->update((uint32_t)Selector::me()->tick());
+	}
+}
+
+//返回false表示连接已关闭
+bool UdpConnection::onArqDatagram(const char* data, const uint32_t size)
+{
+	int n(0);
+	try
+	{
+		n = _arq->input(data, size, _input, (uint32_t)Selector::me()->tick());
+	}
+	catch(const lin_io::ResourceLimitException&)
+	{
+		GLWARN << "read input buffer no space on connection " << dump();
+		handleOnClose("input buffer no space");
+		return false;
+	}
+	if(n < 0)
+	{
+		GLWARN << "arq invalid datagram size: " << size << " on connection " << dump();
+		return true;
+	}
+	if(n == 0)
+	{
+		return true;
+	}
+	*_input.reserve(1) = 0;
+	return deliver();
+}
+
+//回调上层处理输入缓冲的数据, 返回false表示连接已关闭
+bool UdpConnection::deliver()
+{
+	int ret = handleOnData();
+	if(ret < 0)
+	{
+		handleOnInitiativeClose("handle data happen error");
+		return false;
+	}
+	_input.erase(ret);
+	return true;
+}
+
 void UdpConnection::onWrite()
 {
 	lin_io::RcVar<UdpConnection> ref(this);
@@ -469,6 +718,7 @@ bool UdpConnection::handleOnClose(const char* reason) throw()
         _status = DISCONNECTED;
 
         select_timeout();
+        _arqTimer.stop();
         Socket::remove();
         _manager->onClose(reason, this);
         return true;
@@ -489,6 +739,7 @@ bool UdpConnection::handleOnInitiativeClose(const char* reason) throw()
     	_status = DISCONNECTED;
 
     	select_timeout();
+    	_arqTimer.stop();
         Socket::remove();
         _manager->onInitiativeClose(reason, this);
         return true;
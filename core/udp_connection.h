@@ -11,6 +11,7 @@
 
 #include "selector.h"
 #include "connection.h"
+#include "arq_session.h"
 
 namespace net
 {
@@ -31,7 +32,7 @@ public:
     }
     void doConnect(const std::string& ip, const int port)
     {
-        doConnect(lin_io::aton_addr(ip), port);
+        doConnect(aton_addr(ip), port);
     }
     void doConnect(const u_long ip, const int port)
     {
@@ -51,11 +52,15 @@ protected:
     virtual void onConnected(const std::string& desc);
 };
 
-class UdpConnection : public Connection, public UdpClientSocket
+class UdpConnection : public Connection, public UdpClientSocket, public ArqSession::Output
 {
 public:
     //	default connecting timeout 5 sec
     static const uint32_t DEFAULT_CONNECT_TIMEOUT = 5 * 1000;
+    //  udp offload limits: max segments and max bytes per gso send, max bytes per gro recv
+    static const uint32_t UDP_MAX_SEGMENTS = 64;
+    static const uint32_t UDP_MAX_GSO_BYTES = 63 * 1024;
+    static const uint32_t UDP_MAX_GRO_BYTES = 64 * 1024;
 
     typedef lin_io::ByteBuffer InputBuffer;
     typedef lin_io::ByteBuffer OutputBuffer;
@@ -101,10 +106,33 @@ public:
 
     void setBufferSize(const int wbuf, const int rbuf);
 
+    //  分段模式(默认关闭): send()的数据按|segment|大小切分为多个数据报, 内核支持时一次系统调用发出(UDP_SEGMENT)
+    //  |gro|为true时接收内核合并的数据报(UDP_GRO), 拆分后逐个回调onData
+    //  内核不支持时退化为用户态逐个发送, 返回是否开启了内核卸载
+    bool setSegmentation(const uint16_t segment, const bool gro = true);
+    uint16_t getSegmentSize() const {return _segmentSize;}
+
+    //  可靠传输(默认关闭): 开启后send()和onData之间经过ARQ会话, 对端也必须开启
+    //  开启时会关闭分段模式的发送切分
+    void setArq(const ArqConfig& config);
+    bool isReliable() const {return _arq.ptr() != 0;}
+
+    //  监听socket转交的数据报(连接建立前或连接未独占socket时收到)
+    void onDatagram(const char* data, const uint32_t size);
+
     time_t getLastSendTime() {return _lastSendTs;}
     time_t getLastRecvTime() {return _lastRecvTs;}
 protected:
     bool flush() throw_exceptions;
+    uint32_t sendDatagram(const char* data, const uint32_t size) throw_exceptions;
+    int sendSegments(const char* data, const uint32_t size) throw_exceptions;
+    void onReadDatagrams();
+    bool onArqDatagram(const char* data, const uint32_t size);
+    bool deliver();
+
+    //继承ArqSession::Output
+    virtual void output(const char* data, const uint32_t size);
+    void onArqTimer();
 
     //继承ClientSocket
     virtual void onTimeout();
@@ -148,6 +176,15 @@ protected:
     InputBuffer _input;
     std::list<std::string> _output;
 
+    //分段卸载
+    uint16_t _segmentSize;
+    bool _gso;
+    bool _gro;
+
+    //可靠传输
+    lin_io::VarVar<ArqSession> _arq;
+    SimpleTimer<UdpConnection> _arqTimer;
+
     mutable std::string _info;
 };
 
@@ -8,7 +8,7 @@ using namespace net;
 void UdpServer::doAccept(const IClientContext_var& context)
 {
 	net::Manager::get()->createUdpConnection(context->fd, getHostByName(context->peerIP.c_str()), context->peerPort,
-			context->timeoutMs, context->data, context->handler.ptr(), context->listener.ptr());
+			context->timeoutMs, context->data, context->handler.ptr(), context->listener.ptr(), context->arq.get());
 }
 
 //主线程中执行
@@ -19,7 +19,7 @@ void UdpServer::onAccept(IListener* listener, const SOCKET s, const uint32_t cli
     auto serverContext = li->getContext();
     if(serverContext->shareThread)
     {
-    	net::Manager::get()->createUdpConnection(s, clientIp, clientPort, serverContext->timeoutMs, data, li->getHandler()->getClientHandler(), li->getSockets());
+    	net::Manager::get()->createUdpConnection(s, clientIp, clientPort, serverContext->timeoutMs, data, li->getHandler()->getClientHandler(), li->getSockets(), serverContext->arq.get());
     	return;
     }
 
@@ -32,12 +32,23 @@ void UdpServer::onAccept(IListener* listener, const SOCKET s, const uint32_t cli
 
     context->data = data;
     context->listener = li->getSockets();
+    context->arq = serverContext->arq;
 
     uint32_t hashKey = s;
     if(serverContext->hashKey.get())
     {
     	hashKey = *serverContext->hashKey.get();
     }
+    else
+    {
+    	//IO线程绑核时, 放到网卡队列中断CPU附近的线程
+    	int index = Scheduler::instance().getWorkerByCpu(getIncomingCpu(li->getSocket()));
+    	if(index > 0)
+    	{
+    		Scheduler::instance().scheduleTo(index, UdpServer::doAccept, context);
+    		return;
+    	}
+    }
 
 	Scheduler::instance().schedule(hashKey, UdpServer::doAccept, context);
 }
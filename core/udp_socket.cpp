@@ -8,11 +8,124 @@
 
 namespace net
 {
+UdpSendRing::UdpSendRing(const uint32_t capacity, const uint32_t slotSize, const Policy policy)
+: _slots(0)
+, _buffer(0)
+, _capacity(capacity > 0 ? capacity : 1)
+, _slotSize(slotSize)
+, _policy(policy)
+, _head(0)
+, _count(0)
+, _dropped(0)
+, _oversized(0)
+{
+	alloc();
+}
+
+UdpSendRing::~UdpSendRing()
+{
+	release();
+}
+
+void UdpSendRing::alloc()
+{
+	_slots = new Slot[_capacity];
+	_buffer = new char[(size_t)_capacity * _slotSize];
+	for(uint32_t i = 0; i < _capacity; i++)
+	{
+		memset(&_slots[i].addr, 0, sizeof(ipaddr_type));
+		_slots[i].size = 0;
+		_slots[i].data = _buffer + (size_t)i * _slotSize;
+		_slots[i].large = 0;
+	}
+}
+
+void UdpSendRing::release()
+{
+	while(!empty())
+	{
+		pop_front();
+	}
+	delete[] _slots;
+	delete[] _buffer;
+	_slots = 0;
+	_buffer = 0;
+}
+
+bool UdpSendRing::reset(const uint32_t capacity, const uint32_t slotSize, const Policy policy)
+{
+	if(!empty())
+	{
+		return false;
+	}
+	_policy = policy;
+	if(capacity != _capacity || slotSize != _slotSize)
+	{
+		release();
+		_capacity = capacity > 0 ? capacity : 1;
+		_slotSize = slotSize;
+		alloc();
+	}
+	_head = 0;
+	return true;
+}
+
+int UdpSendRing::push_back(const char* data, const uint32_t size, const ipaddr_type* to)
+{
+	if(full())
+	{
+		switch(_policy)
+		{
+		case DROP_OLDEST:
+			pop_front();
+			_dropped++;
+			break;
+		case DROP_NEW:
+			_dropped++;
+			return -1;
+		case BACKPRESSURE:
+			return -2;
+		}
+	}
+
+	Slot& slot = _slots[(_head + _count) % _capacity];
+	memcpy(&slot.addr, to, sizeof(ipaddr_type));
+	if(size > _slotSize)
+	{
+		slot.large = new char[size];
+		slot.data = slot.large;
+		_oversized++;
+	}
+	memcpy(slot.data, data, size);
+	slot.size = size;
+	_count++;
+	return 0;
+}
+
+void UdpSendRing::pop_front()
+{
+	if(empty())
+	{
+		return;
+	}
+	Slot& slot = _slots[_head];
+	if(slot.large)
+	{
+		delete[] slot.large;
+		slot.large = 0;
+		slot.data = _buffer + (size_t)_head * _slotSize;
+	}
+	_head = (_head + 1) % _capacity;
+	_count--;
+}
+
+//------------------
 UdpSocket::UdpSocket(Listener* listener, const std::string& host, const int port)
 : _listener(listener)
 , _timeout(-1)
 , _lastRecvTs(time(0))
 , _lastSendTs(0)
+, _queue(DEFAULT_QUEUE_CAPACITY, DEFAULT_QUEUE_SLOT_SIZE, UdpSendRing::DROP_OLDEST)
 {
 	this->init();
 	if(port > 0)
@@ -26,6 +139,7 @@ UdpSocket::UdpSocket(Listener* listener, const uint32_t ip, const int port)
 , _timeout(-1)
 , _lastRecvTs(time(0))
 , _lastSendTs(0)
+, _queue(DEFAULT_QUEUE_CAPACITY, DEFAULT_QUEUE_SLOT_SIZE, UdpSendRing::DROP_OLDEST)
 {
 	this->init();
 	if(port > 0)
@@ -102,9 +216,14 @@ int UdpSocket::send(const char* data, const uint32_t size, const ipaddr_type* to
         if(n == 0)
         {
         	GLWARN << "0 bytes were sent";
-        	_queue.push_back(std::shared_ptr<UdpData>(new UdpData(data, size, to)));
+        	int ret = _queue.push_back(data, size, to);
+        	if(ret != 0)
+        	{
+        		GLERROR << "queue " << size << " bytes failed: " << ret << " on " << getSocket();
+        		return ret;
+        	}
             select(0, SEL_WRITE);
-            return (int)size;
+            return 0;
         }
         if(n < (int)size)
         {
@@ -115,7 +234,13 @@ int UdpSocket::send(const char* data, const uint32_t size, const ipaddr_type* to
     else
     {
         if(data && size > 0)
-        	_queue.push_back(std::shared_ptr<UdpData>(new UdpData(data, size, to)));
+        {
+        	int ret = _queue.push_back(data, size, to);
+        	if(ret != 0)
+        	{
+        		return ret;
+        	}
+        }
     }
     _lastSendTs = time(NULL);
 	}
@@ -143,15 +268,15 @@ bool UdpSocket::flush() throw_exceptions
 {
     while(!_queue.empty())
     {
-    	auto pk = _queue.front();
-    	int n = socket().sendto(pk->data.data(), (int)pk->data.size(), &pk->addr, (int)sizeof(ipaddr_type));
+    	UdpSendRing::Slot& pk = _queue.front();
+    	int n = socket().sendto(pk.data, (int)pk.size, &pk.addr, (int)sizeof(ipaddr_type));
         if(n == 0)
         {
             break;
         }
-        else if(n < (int)pk->data.size())
+        else if(n < (int)pk.size)
         {
-        	GLERROR << "just " << n << " of " << pk->data.size() << " bytes were sent";
+        	GLERROR << "just " << n << " of " << pk.size << " bytes were sent";
         }
 
         _queue.pop_front();
@@ -207,7 +332,7 @@ void UdpSocket::onWrite()
         if(b)
         {
         	//回调给上层逻辑处理
-            //_handler->onWrite(this);
+            _listener->onWritable(this);
         }
     }
     catch (socket_error& e)
@@ -231,6 +356,16 @@ void UdpSocket::onTimeout()
 	return;
 }
 
+bool UdpSocket::setSendQueue(const uint32_t capacity, const uint32_t slotSize, const UdpSendRing::Policy policy)
+{
+	if(!_queue.reset(capacity, slotSize, policy))
+	{
+		GLWARN << "send queue is not empty, size: " << _queue.size() << " on " << getSocket();
+		return false;
+	}
+	return true;
+}
+
 void UdpSocket::setRecvTimeout(const int msec)
 {
 	_timeout = msec > 0 ? msec : -1;
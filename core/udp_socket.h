@@ -11,14 +11,83 @@
 
 namespace net
 {
+//待发送数据报的环形队列: 槽位在创建时一次性分配, 入队出队不分配内存
+//超过槽位大小的数据报(如GSO大包)单独在堆上拷贝一份, 出队时释放
+//只在IO线程中使用
+class UdpSendRing
+{
+public:
+	//队列满时的处理策略
+	enum Policy
+	{
+		DROP_OLDEST = 0,  //丢弃最早入队的数据报
+		DROP_NEW = 1,     //丢弃新的数据报
+		BACKPRESSURE = 2, //拒绝入队, 由调用方等待可写后重发
+	};
+
+	struct Slot
+	{
+		ipaddr_type addr;
+		uint32_t size;
+		char* data;
+		char* large;//超过槽位大小时的堆上拷贝, 否则为空
+	};
+
+	UdpSendRing(const uint32_t capacity, const uint32_t slotSize, const Policy policy);
+	~UdpSendRing();
+
+	//重新分配槽位, 只能在队列为空时调用
+	bool reset(const uint32_t capacity, const uint32_t slotSize, const Policy policy);
+
+	// 0  : 入队成功
+	// -1 : 数据报被丢弃(DROP_NEW)
+	// -2 : 队列已满(BACKPRESSURE)
+	int push_back(const char* data, const uint32_t size, const ipaddr_type* to);
+	Slot& front() {return _slots[_head];}
+	void pop_front();
+
+	bool empty() const {return _count == 0;}
+	bool full() const {return _count == _capacity;}
+	uint32_t size() const {return _count;}
+	uint32_t capacity() const {return _capacity;}
+	uint32_t slotSize() const {return _slotSize;}
+	Policy policy() const {return _policy;}
+	uint64_t getDropped() const {return _dropped;}
+	uint64_t getOversized() const {return _oversized;}
+
+private:
+	void alloc();
+	void release();
+
+	UdpSendRing(const UdpSendRing&);
+	void operator=(const UdpSendRing&);
+
+private:
+	Slot*    _slots;
+	char*    _buffer;
+	uint32_t _capacity;
+	uint32_t _slotSize;
+	Policy   _policy;
+	uint32_t _head;
+	uint32_t _count;
+	uint64_t _dropped;
+	uint64_t _oversized;//超过槽位大小走堆上拷贝的次数
+};
+
 class UdpSocket : public Socket
 {
 public:
+	//发送队列默认配置
+	static const uint32_t DEFAULT_QUEUE_CAPACITY = 128;
+	static const uint32_t DEFAULT_QUEUE_SLOT_SIZE = 4 * 1024;
+
 	struct Listener
 	{
 		virtual ~Listener() {}
 		virtual void onData(UdpSocket* so, const char* data, const uint32_t size, const ipaddr_type* from) = 0;
 		virtual void onTimeout(UdpSocket* so) = 0;
+		//发送队列清空时回调, BACKPRESSURE策略下可在此重发被拒绝的数据报
+		virtual void onWritable(UdpSocket* so) {}
 
 		//以下函数只有调用create或destroy才会触发回调
 		virtual void onCreate(UdpSocket* so) {}
@@ -31,9 +100,17 @@ public:
 
     SOCKET getSocket();
     ipaddr_type* getLocalAddr();
+    // 0  : 发送成功或已入队
+    // -1 : 发送失败或数据报被丢弃
+    // -2 : 发送队列已满(BACKPRESSURE策略), 等待Listener::onWritable后重发
     virtual int send(const char* data, const uint32_t sz, const ipaddr_type* to);
     virtual int send(const char* data, const uint32_t sz, const uint32_t ip, const uint16_t port);
 
+    //设置发送队列的槽位数量、槽位大小和队列满时的策略, 只能在队列为空时设置
+    //槽位大小以内的数据报入队不分配内存, 更大的数据报单独分配
+    bool setSendQueue(const uint32_t capacity, const uint32_t slotSize, const UdpSendRing::Policy policy);
+    const UdpSendRing& getSendQueue() const {return _queue;}
+
     int getBufferSize();
     void setBufferSize(const int size);
     int getRecvTimeout() {return _timeout;}
@@ -67,14 +144,7 @@ protected:
     time_t _lastRecvTs;
     time_t _lastSendTs;
     ipaddr_type _localAddr;
-
-    struct UdpData
-    {
-    	std::string data;
-    	ipaddr_type addr;
-    	UdpData(const char* buf, const uint32_t len, const ipaddr_type* to):data(buf,len) {memcpy(&addr, &to, (size_t)sizeof(ipaddr_type));}
-    };
-    std::list<std::shared_ptr<UdpData> > _queue;
+    UdpSendRing _queue;
 };
 
 typedef lin_io::RcVar<UdpSocket> UdpSocket_var;
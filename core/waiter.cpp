@@ -0,0 +1,109 @@
+#include "waiter.h"
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+using namespace net;
+
+namespace
+{
+inline void cpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	__asm__ __volatile__("yield" ::: "memory");
+#else
+	__asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+inline int futexWait(std::atomic<int>* addr, const int expected, const struct timespec* timeout = 0)
+{
+	return syscall(SYS_futex, reinterpret_cast<int*>(addr), FUTEX_WAIT_PRIVATE, expected, timeout, 0, 0);
+}
+
+inline int futexWake(std::atomic<int>* addr)
+{
+	return syscall(SYS_futex, reinterpret_cast<int*>(addr), FUTEX_WAKE_PRIVATE, 1, 0, 0, 0);
+}
+
+//本线程当前的自旋上限
+int& spinLimit()
+{
+	static thread_local int limit = Waiter::MIN_SPIN * 8;
+	return limit;
+}
+}
+
+void Waiter::wait()
+{
+	int& limit = spinLimit();
+	for(int i = 0; i < limit; i++)
+	{
+		if(_state.load(std::memory_order_acquire) == STATE_READY)
+		{
+			if(limit < MAX_SPIN)
+				limit <<= 1;
+			return;
+		}
+		cpuRelax();
+	}
+
+	int state = STATE_WAITING;
+	if(_state.compare_exchange_strong(state, STATE_SLEEPING, std::memory_order_acq_rel))
+	{
+		while(_state.load(std::memory_order_acquire) == STATE_SLEEPING)
+		{
+			//EAGAIN(已被唤醒)、EINTR、伪唤醒都重新检查状态
+			futexWait(&_state, STATE_SLEEPING);
+		}
+	}
+	if(limit > MIN_SPIN)
+		limit >>= 1;
+}
+
+bool Waiter::wait_for(const int ms)
+{
+	if(_state.load(std::memory_order_acquire) == STATE_READY)
+		return true;
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	const int64_t end = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec + (int64_t)ms * 1000000LL;
+
+	int state = STATE_WAITING;
+	if(!_state.compare_exchange_strong(state, STATE_SLEEPING, std::memory_order_acq_rel))
+		return state == STATE_READY;
+
+	while(_state.load(std::memory_order_acquire) == STATE_SLEEPING)
+	{
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		int64_t left = end - ((int64_t)now.tv_sec * 1000000000LL + now.tv_nsec);
+		if(left <= 0)
+		{
+			//超时: 回到等待状态; 失败说明刚好被唤醒
+			state = STATE_SLEEPING;
+			return !_state.compare_exchange_strong(state, STATE_WAITING, std::memory_order_acq_rel);
+		}
+		struct timespec timeout;
+		timeout.tv_sec = left / 1000000000LL;
+		timeout.tv_nsec = left % 1000000000LL;
+		futexWait(&_state, STATE_SLEEPING, &timeout);
+	}
+	return true;
+}
+
+bool Waiter::wake()
+{
+	int prev = _state.exchange(STATE_READY, std::memory_order_acq_rel);
+	if(prev == STATE_SLEEPING)
+	{
+		//等待方返回后Waiter可能已释放, futex对失效地址只返回错误, 对复用地址只造成伪唤醒
+		futexWake(&_state);
+	}
+	return prev != STATE_READY;
+}
@@ -0,0 +1,49 @@
+#ifndef __NET_WAITER_H__
+#define __NET_WAITER_H__
+
+#include <atomic>
+
+namespace net
+{
+//一次性等待器: 一个线程等待, 任意线程唤醒一次
+//先短暂自旋, 超过自旋上限后在futex上休眠; 唤醒方只有等待方已休眠时才进入内核
+//自旋上限按线程自适应: 自旋期间等到结果就放宽, 最终休眠就收紧
+class Waiter
+{
+public:
+	enum
+	{
+		MIN_SPIN = 16,
+		MAX_SPIN = 4096,
+	};
+
+	Waiter():_state(STATE_WAITING) {}
+
+	//重新进入等待状态, 只能在没有线程等待时调用
+	void reset() {_state.store(STATE_WAITING, std::memory_order_relaxed);}
+	bool ready() const {return _state.load(std::memory_order_acquire) == STATE_READY;}
+
+	//等待唤醒, 已经唤醒时直接返回
+	void wait();
+	//最多等待|ms|毫秒, 返回false表示超时; 超时后可以再次等待
+	bool wait_for(const int ms);
+	//返回false表示已经唤醒过
+	bool wake();
+
+private:
+	enum State
+	{
+		STATE_WAITING = 0,
+		STATE_SLEEPING = 1,//等待方已进入futex
+		STATE_READY = 2,
+	};
+
+	Waiter(const Waiter&);
+	void operator=(const Waiter&);
+
+private:
+	std::atomic<int> _state;
+};
+}
+
+#endif
@@ -7,13 +7,43 @@
  * @Description: 这是默认设置,请设置`customMade`, 打开koroFileHeader查看配置 进行设置: https://github.com/OBKoro1/koro1FileHeader/wiki/%E9%85%8D%E7%BD%AE
  */
 #include "worker.h"
+#include <algorithm>
+#include <set>
 #include "log/logger.h"
 #include "common.h"
 #include "manager.h"
 #include "selector.h"
+#include "cpu_affinity.h"
 
 namespace net
 {
+namespace
+{
+//每处理这么多个任务更新一次时间(时间预算和排队时延共用)
+const uint32_t BUDGET_CHECK_INTERVAL = 16;
+}
+
+const char* TaskName::intern(const std::string& name)
+{
+	static lin_io::SpinLock lock;
+	static std::set<std::string> names;
+	{
+		lin_io::ScopLock<lin_io::SpinLock> sync(lock);
+		std::set<std::string>::iterator it = names.find(name);
+		if(it != names.end())
+			return it->c_str();
+		if(names.size() < MAX_INTERNED)
+			return names.insert(name).first->c_str();
+	}
+	//名字不应是动态生成的, 超出上限不再驻留, 避免无限增长
+	static std::atomic<bool> warned(false);
+	if(!warned.exchange(true))
+	{
+		GLWARN << "too many distinct task names (" << MAX_INTERNED << "), " << name << " is recorded as task";
+	}
+	return "task";
+}
+
 void* work_loop_routine(void *ptr)
 {
 	Worker *w = (Worker *)ptr;
@@ -25,8 +55,9 @@ void* work_loop_routine(void *ptr)
 
 void Worker::start()
 {
-	//启动主线程
-	int ret = pthread_create(&_tid, NULL, work_loop_routine, this);
+	//启动主线程, 线程ID由线程自己设置
+	pthread_t thread;
+	int ret = pthread_create(&thread, NULL, work_loop_routine, this);
 	if (ret != 0)
 	{
 		GLERROR << "create thread error: " << ret;
@@ -36,14 +67,19 @@ void Worker::start()
 void Worker::run()
 {
 	//设置线程ID
-	_tid = net::getThreadId();
+	_thread.store(pthread_self(), std::memory_order_release);
+	_tid = (pid_t)net::getThreadId();
+
+	GLINFO << "io worker thread start, id: " << _workerId << " thread id: " << _tid << " cpu: " << _cpu;
+
+	//先绑核再分配IO内存, 使Selector/Manager等首次访问的内存落在本NUMA节点
+	if(_cpu >= 0)
+		CpuTopology::bind(_cpu);
 
-	GLINFO << "io worker thread start, id: " << _workerId << " thread id: " << _tid;
 	_queue.connect(this);
 
-	//分配IO内存(0号主线线不分配)
-	if(_workerId)
-		net::Manager::get(_workerId-1);
+	//分配IO内存, 连接ID中的所属线程即为_workerId
+	net::Manager::get(_workerId);
 
 	//进行IO事件循环
 	net::Selector::me()->mainloop();
@@ -54,48 +90,181 @@ void Worker::run()
 
 void Worker::onSignals(uint8_t e)
 {
-	std::deque<Task*> cs;
-	_queue.get(cs);
-	if (cs.empty()) {return;}
-	for(std::deque<Task*>::iterator c = cs.begin(); c != cs.end(); c++)
+	//每轮只处理进入时各通道已有的任务, 之后到达的留到下一轮事件循环
+	//先处理已有的紧急任务, 之后每处理一个普通/批量任务最多插入一个新到的紧急任务
+	//上一轮被预算截断时, 本轮从被截断通道的下一个通道开始, 持续过载时各通道轮流先处理, 不会一直饿死低优先级
+	const int first = _firstLane;
+	_firstLane = PRIORITY_URGENT;
+	int lane = first;
+	size_t quota[PRIORITY_COUNT];
+	for(int i = 0; i < PRIORITY_COUNT; i++)
+	{
+		quota[i] = std::max(_queue.size(i), (size_t)1);
+	}
+
+	//预算用完即让出, 剩余任务通过补发的通知在下一轮处理, 期间先处理网络事件
+	const uint32_t taskBudget = _taskBudget.load(std::memory_order_relaxed);
+	const uint32_t timeBudget = _timeBudget.load(std::memory_order_relaxed);
+	const int64_t start = getMonotonicUs();
+	int64_t now = start;
+	uint32_t done = 0;
+	bool insertUrgent = false;
+
+	for(;;)
 	{
-		if (*c == 0) {continue;}
-		try
+		if(taskBudget > 0 && done >= taskBudget)
 		{
-			if(!(*c)->run())
+			_firstLane = (lane + 1) % PRIORITY_COUNT;
+			break;
+		}
+		if(done > 0 && done % BUDGET_CHECK_INTERVAL == 0)
+		{
+			now = getMonotonicUs();
+			if(timeBudget > 0 && now - start >= timeBudget)
 			{
-				delete *c;
+				_firstLane = (lane + 1) % PRIORITY_COUNT;
+				break;
 			}
 		}
-		catch(const std::exception& e)
+
+		Task* c = 0;
+		if(insertUrgent)
 		{
-			GLERROR << "task name: " << (*c)->name() << " happen error: " << e.what();
-			delete *c;
+			c = _queue.pop(PRIORITY_URGENT);
+			insertUrgent = false;
 		}
-		catch(...)
+		for(int k = 0; k < PRIORITY_COUNT && !c; k++)
 		{
-			GLERROR << "task name: " << (*c)->name() << " happen error";
-			delete *c;
+			const int i = (first + k) % PRIORITY_COUNT;
+			if(quota[i] == 0)
+				continue;
+			c = _queue.pop(i);
+			quota[i] = c ? quota[i] - 1 : 0;
+			if(c)
+			{
+				lane = i;
+				insertUrgent = i != PRIORITY_URGENT;
+			}
 		}
+		if (c == 0) {break;}
+		measure(c, now);
+		execute(c);
+		done++;
+	}
+
+	//取空时开启下次通知, 否则(或期间又有任务入队)补发通知
+	if(_queue.size() > 0 || !_queue.rest())
+	{
+		_queue.notify();
+	}
+	else
+	{
+		idle();
 	}
 }
 
-bool Worker::addTask(Task *c)
+//CoDel: 只要有任务的排队时延低于目标, 队列就还能排空;
+//整个窗口内都超过目标才认为过载, 短暂的突发不会触发拒绝
+void Worker::measure(Task* c, const int64_t now)
 {
-	if(_queue.size() > _queueLimit)
+	int64_t sojourn = std::max(now - c->_queueTime, (int64_t)0);
+	_sojourn.store((uint32_t)std::min(sojourn, (int64_t)UINT32_MAX), std::memory_order_relaxed);
+
+	const uint32_t target = _target.load(std::memory_order_relaxed);
+	if(target == 0 || sojourn < target)
+	{
+		idle();
+		return;
+	}
+
+	if(_aboveSince == 0)
+	{
+		_aboveSince = now;
+		return;
+	}
+	if(!_overloaded.load(std::memory_order_relaxed) && now - _aboveSince >= _interval.load(std::memory_order_relaxed))
 	{
-		//控制频率
-		time_t currTime = time(0);
-		static time_t lastTime = 0;
-		if(currTime - lastTime > 1)
+		_overloaded.store(true, std::memory_order_relaxed);
+		GLWARN << "worker" << _workerId << " overloaded, sojourn: " << sojourn << "us queue size: " << _queue.size();
+	}
+}
+
+void Worker::idle()
+{
+	_aboveSince = 0;
+	if(_overloaded.load(std::memory_order_relaxed))
+	{
+		_overloaded.store(false, std::memory_order_relaxed);
+		GLINFO << "worker" << _workerId << " recovered, rejected: " << _rejected.load(std::memory_order_relaxed);
+	}
+}
+
+void Worker::execute(Task* c)
+{
+	try
+	{
+		if(!c->run())
 		{
-			lastTime = currTime;
-			GLERROR << "worker" << _workerId << " add task failed, limit " << _queueLimit;
-			//上报监控
+			delete c;
 		}
-		return false;
 	}
-	_queue.push(c);
-	return true;
+	catch(const std::exception& e)
+	{
+		GLERROR << "task name: " << c->name() << " happen error: " << e.what();
+		delete c;
+	}
+	catch(...)
+	{
+		GLERROR << "task name: " << c->name() << " happen error";
+		delete c;
+	}
+}
+
+ScheduleError Worker::admit(const TaskPriority priority, const uint32_t count)
+{
+	if(priority == PRIORITY_URGENT)
+		return SCHEDULE_OK;
+
+	if(_queue.size() + count > _queueLimit)
+		return reject(SCHEDULE_QUEUE_FULL, priority, count);
+
+	if(_overloaded.load(std::memory_order_relaxed))
+	{
+		int policy = _policy.load(std::memory_order_relaxed);
+		if(policy == SHED_FAIL_FAST || (policy == SHED_BULK && priority == PRIORITY_BULK))
+			return reject(SCHEDULE_OVERLOAD, priority, count);
+	}
+	return SCHEDULE_OK;
+}
+
+ScheduleError Worker::reject(const ScheduleError err, const TaskPriority priority, const uint32_t count)
+{
+	uint64_t rejected = _rejected.fetch_add(count, std::memory_order_relaxed) + count;
+
+	//控制频率: 多个生产者线程中只有一个每秒记录一次
+	int64_t currTime = time(0);
+	int64_t lastTime = _lastReject.load(std::memory_order_relaxed);
+	if(currTime - lastTime >= 1 && _lastReject.compare_exchange_strong(lastTime, currTime))
+	{
+		GLERROR << "worker" << _workerId << " add task failed, error: " << err << " priority: " << priority
+			<< " size: " << _queue.size() << " limit: " << _queueLimit << " sojourn: " << getSojourn() << "us rejected: " << rejected;
+		//上报监控
+	}
+	return err;
+}
+
+ScheduleError Worker::addTask(Task *c, const TaskPriority priority)
+{
+	ScheduleError err = admit(priority);
+	if(err != SCHEDULE_OK)
+		return err;
+	c->_queueTime = getMonotonicUs();
+	_queue.push(c, priority);
+	return SCHEDULE_OK;
+}
+
+void Worker::addTasks(Task* first, Task* last, const uint32_t count, const TaskPriority priority)
+{
+	_queue.push(first, last, count, priority);
 }
 }
@@ -5,15 +5,66 @@
 #include <pthread.h>
 #include "thread.h"
 #include "queue.h"
+#include "task_pool.h"
+#include "waiter.h"
 
 namespace net
 {
-class Task
+//任务优先级: 控制类任务(创建/删除服务、关闭连接)走紧急通道, 不排在大量数据任务之后
+enum TaskPriority
+{
+	PRIORITY_URGENT = 0,
+	PRIORITY_NORMAL = 1,
+	PRIORITY_BULK = 2,
+	PRIORITY_COUNT = 3,
+};
+
+//调度结果, 调度失败时可通过Scheduler::lastError()取得原因
+enum ScheduleError
+{
+	SCHEDULE_OK = 0,
+	SCHEDULE_QUIT = 1,        //正在退出
+	SCHEDULE_NO_WORKER = 2,   //目标线程不存在
+	SCHEDULE_QUEUE_FULL = 3,  //队列长度超过上限
+	SCHEDULE_OVERLOAD = 4,    //排队时延持续超过目标, 快速失败
+};
+
+//过载(排队时延持续超过目标)时的丢弃策略, 紧急任务总是接受
+enum ShedPolicy
+{
+	SHED_NONE = 0,       //只按队列长度限制
+	SHED_BULK = 1,       //过载时拒绝批量任务
+	SHED_FAIL_FAST = 2,  //过载时拒绝普通和批量任务
+};
+
+//任务名: 字符串常量直接保存指针, std::string驻留后保存(同名只保存一份, 进程内不释放)
+//std::string只用于有限个固定的名字, 不要拼接连接ID、序号等; 超过MAX_INTERNED个不同名字后统一记为"task"
+class TaskName
+{
+public:
+	TaskName(const char* name):_name(name) {}
+	TaskName(const std::string& name):_name(intern(name)) {}
+	const char* c_str() const {return _name;}
+
+	enum { MAX_INTERNED = 1024 };
+	static const char* intern(const std::string& name);
+private:
+	const char* _name;
+};
+
+//任务对象从TaskPool分配, 跨线程调度不再每次malloc
+class Task : public MpscNode
 {
 public:
+	Task():_queueTime(0) {}
 	virtual ~Task() {}
 	virtual bool run() = 0;
-	virtual const std::string& name() = 0;
+	virtual const char* name() = 0;
+
+	static void* operator new(size_t size) {return TaskPool::alloc(size);}
+	static void operator delete(void* ptr) {TaskPool::free(ptr);}
+
+	int64_t _queueTime;//入队时间(微秒), 用于计算排队时延
 };
 
 template<typename OBJ,typename ARG>
@@ -21,8 +72,8 @@ class Executor : public Task
 {
 public:
 	virtual ~Executor() {}
-	Executor(OBJ* obj, void(OBJ::*fun)(const ARG& req), const ARG& req, const std::string& name="task")
-    :_obj(obj),_fun(fun),_req(req),_name(name)
+	Executor(OBJ* obj, void(OBJ::*fun)(const ARG& req), const ARG& req, const TaskName& name="task")
+    :_obj(obj),_fun(fun),_req(req),_name(name.c_str())
 	{
 	}
 	virtual bool run()
@@ -30,12 +81,12 @@ public:
     	(_obj->*_fun)(_req);
     	return false;
     }
-	virtual const std::string& name() {return _name;}
+	virtual const char* name() {return _name;}
 private:
     OBJ* _obj;
 	void(OBJ::*_fun)(const ARG& req);
 	ARG _req;
-	std::string _name;
+	const char* _name;
 };
 
 template<typename ARG>
@@ -43,8 +94,8 @@ class Executor<void,ARG> : public Task
 {
 public:
 	virtual ~Executor() {}
-	Executor(void(*fun)(const ARG& req), const ARG& req, const std::string& name="task")
-    :_fun(fun),_req(req),_name(name)
+	Executor(void(*fun)(const ARG& req), const ARG& req, const TaskName& name="task")
+    :_fun(fun),_req(req),_name(name.c_str())
 	{
 	}
 	virtual bool run()
@@ -52,42 +103,30 @@ public:
     	(*_fun)(_req);
     	return false;
     }
-	virtual const std::string& name() {return _name;}
+	virtual const char* name() {return _name;}
 private:
 	void(*_fun)(const ARG& req);
 	ARG _req;
-	std::string _name;
+	const char* _name;
 };
 
 //====================
+//同步调度的等待条件: 一次性, futex实现
 struct Condition
 {
 public:
-	enum status {ready,wait,};
-	Condition():_status(wait) {}
+	Condition() {}
 	virtual ~Condition() {}
 	void yield()
 	{
-		lin_io::ScopLock<lin_io::Condition> sync(_cond);
-		while(_status == wait)
-		{
-			_cond.wait();
-		}
+		_waiter.wait();
 	}
 	bool resume()
 	{
-		lin_io::ScopLock<lin_io::Condition> sync(_cond);
-		if(_status != wait)
-		{
-			return false;
-		}
-		_status = ready;
-		_cond.notify();
-		return true ;
+		return _waiter.wake();
 	}
 private:
-	lin_io::Condition _cond;
-	status 	        _status;
+	Waiter _waiter;
 };
 
 template<typename OBJ,typename REQ,typename RSP>
@@ -95,8 +134,8 @@ class ExecutorEx : public Task
 {
 public:
 	virtual ~ExecutorEx() {_cond.resume();}
-	ExecutorEx(OBJ* obj, void(OBJ::*fun)(const REQ& req, RSP& rsp), const REQ& req, RSP& rsp, net::Condition& cond, const std::string& name="task")
-    :_obj(obj),_fun(fun),_req(req),_rsp(rsp),_cond(cond),_name(name)
+	ExecutorEx(OBJ* obj, void(OBJ::*fun)(const REQ& req, RSP& rsp), const REQ& req, RSP& rsp, net::Condition& cond, const TaskName& name="task")
+    :_obj(obj),_fun(fun),_req(req),_rsp(rsp),_cond(cond),_name(name.c_str())
 	{
 	}
 	virtual bool run()
@@ -104,14 +143,14 @@ public:
     	(_obj->*_fun)(_req, _rsp);
     	return false;
     }
-	virtual const std::string& name() {return _name;}
+	virtual const char* name() {return _name;}
 private:
     OBJ* _obj;
 	void(OBJ::*_fun)(const REQ& req, RSP& rsp);
 	const REQ& _req;
 	RSP& _rsp;
 	net::Condition& _cond;
-	std::string _name;
+	const char* _name;
 };
 
 template<typename REQ,typename RSP>
@@ -119,8 +158,8 @@ class ExecutorEx<void,REQ,RSP> : public Task
 {
 public:
 	virtual ~ExecutorEx() {_cond.resume();}
-	ExecutorEx(void(*fun)(const REQ& req, RSP& rsp), const REQ& req, RSP& rsp, net::Condition& cond, const std::string& name="task")
-    :_fun(fun),_req(req),_rsp(rsp),_cond(cond),_name(name)
+	ExecutorEx(void(*fun)(const REQ& req, RSP& rsp), const REQ& req, RSP& rsp, net::Condition& cond, const TaskName& name="task")
+    :_fun(fun),_req(req),_rsp(rsp),_cond(cond),_name(name.c_str())
 	{
 	}
 	virtual bool run()
@@ -128,20 +167,29 @@ public:
     	(*_fun)(_req, _rsp);
     	return false;
     }
-	virtual const std::string& name() {return _name;}
+	virtual const char* name() {return _name;}
 private:
 	void(*_fun)(const REQ& req, RSP& rsp);
 	const REQ& _req;
 	RSP& _rsp;
 	net::Condition& _cond;
-	std::string _name;
+	const char* _name;
 };
 
 class Worker : public Notifier::SignalHandler
 {
 public:
+	//每轮任务预算: 默认最多处理4096个任务或2毫秒
+	enum { DEFAULT_TASK_BUDGET = 4096, DEFAULT_TIME_BUDGET = 2000 };
+	//过载判断: 排队时延在整个窗口内都超过目标(CoDel), 默认20毫秒/200毫秒
+	enum { DEFAULT_SOJOURN_TARGET = 20000, DEFAULT_SOJOURN_INTERVAL = 200000 };
+
 	Worker(const int id, const int limit=1000000)
-	:_tid(0), _workerId(id), _queueLimit(limit)
+	:_thread(0), _tid(0), _workerId(id), _queueLimit(limit), _cpu(-1)
+	,_taskBudget(DEFAULT_TASK_BUDGET), _timeBudget(DEFAULT_TIME_BUDGET)
+	,_policy(SHED_FAIL_FAST), _target(DEFAULT_SOJOURN_TARGET), _interval(DEFAULT_SOJOURN_INTERVAL)
+	,_aboveSince(0), _overloaded(false), _sojourn(0), _lastReject(0), _rejected(0), _load(0)
+	,_firstLane(PRIORITY_URGENT)
 	{
 	}
 
@@ -152,16 +200,73 @@ public:
 
 	void run();
 	void start();
-	bool addTask(Task *c);
+	//紧急任务不受队列长度和过载限制; 失败时不删除任务
+	ScheduleError addTask(Task *c, const TaskPriority priority = PRIORITY_NORMAL);
+	//一次提交用_mpscNext串起来的|count|个任务, 最多唤醒一次; 任务已设置_queueTime且已逐个通过admit(), 不再检查
+	void addTasks(Task* first, Task* last, const uint32_t count, const TaskPriority priority = PRIORITY_NORMAL);
+	//入队前检查是否接受|count|个任务, 拒绝时按秒限频记录日志
+	ScheduleError admit(const TaskPriority priority, const uint32_t count = 1);
 	uint32_t getWorkerId() {return _workerId;}
 	uint32_t getQueueSize() {return _queue.size();}
-	pthread_t getThreadId() {return _tid;}
+	//线程启动前为0
+	pthread_t getThreadId() const {return _thread.load(std::memory_order_acquire);}
+	//当前线程是否为本IO线程
+	bool isCurrentThread() const {return pthread_equal(getThreadId(), pthread_self()) != 0;}
+
+	//绑定的CPU, -1为不绑定; 必须在start()之前设置
+	void setCpu(const int cpu) {_cpu = cpu;}
+	int getCpu() const {return _cpu;}
+
+	//每轮事件循环最多处理|tasks|个任务、最多|us|微秒(0为不限), 超出的留到下一轮
+	//任务风暴时穿插处理网络事件, 运行中可修改
+	void setBudget(const uint32_t tasks, const uint32_t us)
+	{
+		_taskBudget.store(tasks, std::memory_order_relaxed);
+		_timeBudget.store(us, std::memory_order_relaxed);
+	}
+
+	//过载策略: 排队时延在|intervalUs|内都超过|targetUs|时按|policy|拒绝任务, targetUs为0不检测
+	void setAdmission(const ShedPolicy policy, const uint32_t targetUs, const uint32_t intervalUs)
+	{
+		_policy.store(policy, std::memory_order_relaxed);
+		_target.store(targetUs, std::memory_order_relaxed);
+		_interval.store(intervalUs, std::memory_order_relaxed);
+	}
+	bool isOverloaded() const {return _overloaded.load(std::memory_order_relaxed);}
+	//最近出队任务的排队时延(微秒)
+	uint32_t getSojourn() const {return _sojourn.load(std::memory_order_relaxed);}
+	uint64_t getRejected() const {return _rejected.load(std::memory_order_relaxed);}
+
+	//负载采样(见Rebalancer): 最近一个周期本线程连接的收发字节数
+	void setLoad(const uint64_t load) {_load.store(load, std::memory_order_relaxed);}
+	uint64_t getLoad() const {return _load.load(std::memory_order_relaxed);}
+
+private:
+	void execute(Task* c);
+	//IO线程: 按出队任务的排队时延更新过载状态
+	void measure(Task* c, const int64_t now);
+	void idle();
+	ScheduleError reject(const ScheduleError err, const TaskPriority priority, const uint32_t count);
 
 private:
-	pthread_t _tid;
+	std::atomic<pthread_t> _thread;//pthread_self(), 由IO线程自己设置
+	pid_t _tid;//内核线程ID, 只用于日志
 	uint32_t _workerId;
 	uint32_t _queueLimit;
-	SingleConsumerQueue<Task> _queue;
+	int _cpu;
+	std::atomic<uint32_t> _taskBudget;
+	std::atomic<uint32_t> _timeBudget;//微秒
+	std::atomic<int> _policy;
+	std::atomic<uint32_t> _target;//微秒
+	std::atomic<uint32_t> _interval;//微秒
+	int64_t _aboveSince;//IO线程: 排队时延开始超过目标的时间, 0为未超过
+	std::atomic<bool> _overloaded;
+	std::atomic<uint32_t> _sojourn;
+	std::atomic<int64_t> _lastReject;//上次记录拒绝日志的时间(秒)
+	std::atomic<uint64_t> _rejected;
+	std::atomic<uint64_t> _load;
+	int _firstLane;//IO线程: 下一轮最先处理的通道, 上一轮被预算截断时轮到下一个通道
+	MpscQueue<Task, Notifier, PRIORITY_COUNT> _queue;
 };
 
 }
@@ -0,0 +1,143 @@
+//ArqSession丢包/乱序/重复模拟: 两个会话经过模拟链路互相传输字节流, 检查按序完整交付
+#include <string>
+#include <map>
+#include <random>
+#include "core/arq_session.h"
+#include "check.h"
+
+using namespace net;
+
+namespace
+{
+struct LinkConfig
+{
+	int lossPercent;   //丢弃比例
+	int dupPercent;    //重复比例
+	uint32_t latency;  //单向时延(ms)
+	uint32_t jitter;   //额外随机时延(ms), 大于发送间隔时产生乱序
+};
+
+//单向模拟链路: 按到达时间排序投递
+class Link : public ArqSession::Output
+{
+public:
+	Link(const LinkConfig& config, std::mt19937& rng):_config(config),_rng(rng),_now(0),_sent(0),_lost(0) {}
+
+	void setNow(const uint32_t now) {_now = now;}
+
+	virtual void output(const char* data, const uint32_t size)
+	{
+		_sent++;
+		if((int)(_rng() % 100) < _config.lossPercent)
+		{
+			_lost++;
+			return;
+		}
+		int copies = (int)(_rng() % 100) < _config.dupPercent ? 2 : 1;
+		for(int i = 0; i < copies; i++)
+		{
+			uint32_t delay = _config.latency + (_config.jitter ? (uint32_t)(_rng() % (_config.jitter + 1)) : 0);
+			_inflight.insert(std::make_pair(_now + delay, std::string(data, size)));
+		}
+	}
+
+	//投递到期的数据报
+	void deliver(ArqSession& to, lin_io::ByteBuffer& stream, const uint32_t now)
+	{
+		while(!_inflight.empty() && _inflight.begin()->first <= now)
+		{
+			const std::string& datagram = _inflight.begin()->second;
+			CHECK(to.input(datagram.data(), (uint32_t)datagram.size(), stream, now) >= 0);
+			_inflight.erase(_inflight.begin());
+		}
+	}
+
+	uint64_t sent() const {return _sent;}
+	uint64_t lost() const {return _lost;}
+
+private:
+	LinkConfig _config;
+	std::mt19937& _rng;
+	uint32_t _now;
+	std::multimap<uint32_t, std::string> _inflight;
+	uint64_t _sent;
+	uint64_t _lost;
+};
+
+std::string pattern(const size_t size, const uint32_t seed)
+{
+	std::string s(size, 0);
+	uint32_t x = seed;
+	for(size_t i = 0; i < size; i++)
+	{
+		x = x * 1103515245 + 12345;
+		s[i] = (char)(x >> 16);
+	}
+	return s;
+}
+
+//双向各发送|bytes|字节, 返回完成用时(ms)
+uint32_t transfer(const LinkConfig& link, const size_t bytes, const uint32_t seed)
+{
+	std::mt19937 rng(seed);
+	ArqConfig config;
+	Link ab(link, rng), ba(link, rng);
+	ArqSession a(config, &ab), b(config, &ba);
+
+	const std::string da = pattern(bytes, seed);
+	const std::string db = pattern(bytes, seed + 1);
+	//分多次写入, 检查不保留消息边界
+	for(size_t off = 0; off < bytes; off += 3000)
+	{
+		a.send(da.data() + off, (uint32_t)std::min((size_t)3000, bytes - off));
+		b.send(db.data() + off, (uint32_t)std::min((size_t)3000, bytes - off));
+	}
+
+	lin_io::ByteBuffer ra, rb;
+	const uint32_t limit = 600 * 1000;
+	uint32_t now = 0;
+	for(; now < limit; now++)
+	{
+		ab.setNow(now);
+		ba.setNow(now);
+		ab.deliver(b, rb, now);
+		ba.deliver(a, ra, now);
+		if(now % config.interval == 0)
+		{
+			CHECK(a.update(now));
+			CHECK(b.update(now));
+		}
+		if(ra.size() == bytes && rb.size() == bytes && a.waitSend() == 0 && b.waitSend() == 0)
+			break;
+	}
+	CHECK(now < limit);
+	CHECK(rb.size() == bytes && std::string(rb.data(), rb.size()) == da);
+	CHECK(ra.size() == bytes && std::string(ra.data(), ra.size()) == db);
+	if(link.lossPercent > 0)
+	{
+		CHECK(ab.lost() > 0 && a.getRetransmits() > 0);
+		CHECK(ba.lost() > 0 && b.getRetransmits() > 0);
+	}
+	printf("loss %d%% dup %d%% latency %ums jitter %ums: %zu bytes each way in %ums, datagrams %llu/%llu lost %llu/%llu, retransmits %llu/%llu\n"
+		, link.lossPercent, link.dupPercent, link.latency, link.jitter, bytes, now
+		, (unsigned long long)ab.sent(), (unsigned long long)ba.sent()
+		, (unsigned long long)ab.lost(), (unsigned long long)ba.lost()
+		, (unsigned long long)a.getRetransmits(), (unsigned long long)b.getRetransmits());
+	return now;
+}
+}
+
+int main()
+{
+	const size_t bytes = 256 * 1024;
+	//无损链路
+	transfer(LinkConfig{0, 0, 5, 0}, bytes, 1);
+	//只乱序
+	transfer(LinkConfig{0, 0, 5, 40}, bytes, 2);
+	//丢包 + 乱序 + 重复
+	transfer(LinkConfig{5, 2, 10, 30}, bytes, 3);
+	transfer(LinkConfig{10, 5, 20, 50}, bytes, 4);
+	transfer(LinkConfig{30, 5, 20, 50}, bytes, 5);
+	printf("ok\n");
+	return 0;
+}
@@ -0,0 +1,108 @@
+//批量作用域内的同步调用: 等待前提交暂存的IO任务, 按连接的结果(这里是连接不存在)返回, 不会一直阻塞
+//已暂存(返回成功)的任务flush()时不再检查, 退出过程中也照常入队, 不会被删除
+#include <unistd.h>
+#include <signal.h>
+#include <atomic>
+#include "core/interface.h"
+#include "core/batch.h"
+#include "check.h"
+
+using namespace net;
+
+namespace
+{
+struct Ping
+{
+	uint32_t value;
+	bool serialize(lin_io::Pack& pack) const
+	{
+		pack.push_uint32(value);
+		return true;
+	}
+};
+
+struct Pong
+{
+	uint32_t value;
+};
+
+//不存在的连接: IO任务执行后以CONNECTION_CLOSED结束
+const uint32_t CONNID = makeConnId(1, 4321);
+
+std::atomic<int> ran(0);
+
+void onRun(const int& v)
+{
+	ran.fetch_add(1);
+}
+
+bool waitRan(const int n)
+{
+	for(int i = 0; i < 200 && ran.load() < n; i++)
+		usleep(5000);
+	return ran.load() >= n;
+}
+
+void onAlarm(int)
+{
+	fprintf(stderr, "blocked in batch scope\n");
+	_exit(1);
+}
+}
+
+int main()
+{
+	Scheduler::instance().start(2);
+	//修复前调用会一直阻塞, 超时直接失败
+	signal(SIGALRM, onAlarm);
+	alarm(10);
+
+	{
+		Scheduler::BatchScope scope;
+		int code = 0;
+		try
+		{
+			Ping req = {1};
+			Pong rsp;
+			Interface(CONNID).call(1u, req, rsp, 3000);
+		}
+		catch(RuntimeException& e)
+		{
+			code = e.getCode();
+		}
+		CHECK(code == RpcException::CONNECTION_CLOSED);
+	}
+
+	{
+		Scheduler::BatchScope scope;
+		Ping req = {2};
+		Pong rsp1, rsp2;
+		Batch batch(CONNID);
+		batch.add(1u, req, rsp1).add(2u, req, rsp2);
+		CHECK(batch.call(3000) == 0);
+		CHECK(batch.code(0) == RpcException::CONNECTION_CLOSED);
+		CHECK(batch.code(1) == RpcException::CONNECTION_CLOSED);
+	}
+
+	//暂存后到flush()之间开始退出: 已返回成功的任务和定时器仍然入队执行, 句柄引用的任务没有被删除
+	{
+		Scheduler& scheduler = Scheduler::instance();
+		TimerHandle timer;
+		{
+			Scheduler::BatchScope scope;
+			CHECK(scheduler.scheduleTo(1, onRun, 0, "staged"));
+			timer = scheduler.scheduleAfter(1, 10, onRun, 0, "stagedTimer");
+			CHECK(timer.valid());
+			scheduler._quit = true;
+		}
+		scheduler._quit = false;
+		CHECK(waitRan(2));
+		CHECK(!timer.pending());
+		timer.reset();
+	}
+
+	printf("ok\n");
+	fflush(stdout);
+	//IO线程不退出, 直接结束进程
+	_exit(0);
+}
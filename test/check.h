@@ -0,0 +1,18 @@
+#ifndef __NET_TEST_CHECK_H__
+#define __NET_TEST_CHECK_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+
+//测试断言: 失败时打印位置并以非0退出, 由ctest判定失败
+#define CHECK(cond) \
+	do \
+	{ \
+		if(!(cond)) \
+		{ \
+			fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+			exit(1); \
+		} \
+	} while(0)
+
+#endif
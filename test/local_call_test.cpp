@@ -0,0 +1,86 @@
+//协程内的同步调用: 在连接所属IO线程上走local_call(不投递任务, 不阻塞IO线程)
+#include <unistd.h>
+#include <atomic>
+#include "core/interface.h"
+#include "check.h"
+
+using namespace net;
+
+namespace
+{
+struct Ping
+{
+	uint32_t value;
+	bool serialize(lin_io::Pack& pack) const
+	{
+		pack.push_uint32(value);
+		return true;
+	}
+};
+
+struct Pong
+{
+	uint32_t value;
+};
+
+const uint32_t OWNER = 1;
+//所属线程上没有这个连接: local_call在当前线程查找连接, 不投递任务, 立即抛出CONNECTION_CLOSED
+const uint32_t CONNID = makeConnId(OWNER, 12345);
+const int CALL_TIMEOUT = 500;
+
+std::atomic<int> done(0);
+bool ownerOnWorker = false;
+bool otherOnWorker = true;
+int code = 0;
+int64_t elapsedMs = 0;
+
+void callInCoroutine()
+{
+	const int64_t t0 = lin_io::nowUs();
+	try
+	{
+		Ping req = {1};
+		Pong rsp;
+		Interface(CONNID).call(1u, req, rsp, CALL_TIMEOUT);
+	}
+	catch(RuntimeException& e)
+	{
+		code = e.getCode();
+	}
+	elapsedMs = (lin_io::nowUs() - t0) / 1000;
+}
+
+void onWorker(const int& v)
+{
+	ownerOnWorker = Scheduler::instance().isOwnerThread(CONNID);
+	otherOnWorker = Scheduler::instance().isOwnerThread(makeConnId(OWNER + 1, 12345));
+
+	lin_io::RcVar<lin_io::Coroutine> co(lin_io::Coroutine::create(callInCoroutine, 64*1024));
+	lin_io::Coroutine::resume(co.ptr());
+	done.store(1);
+}
+}
+
+int main()
+{
+	Scheduler& scheduler = Scheduler::instance();
+	scheduler.start(2);
+	for(int i = 0; i < 200 && !scheduler.getWorker(OWNER)->getThreadId(); i++)
+		usleep(5000);
+
+	CHECK(!scheduler.isOwnerThread(CONNID));
+	CHECK(scheduler.scheduleConnection(CONNID, onWorker, 0, "onWorker"));
+	for(int i = 0; i < 400 && !done.load(); i++)
+		usleep(5000);
+	CHECK(done.load());
+
+	CHECK(ownerOnWorker);
+	CHECK(!otherOnWorker);
+	CHECK(code == RpcException::CONNECTION_CLOSED);
+	CHECK(elapsedMs < CALL_TIMEOUT / 2);
+
+	printf("ok\n");
+	fflush(stdout);
+	//IO线程不退出, 直接结束进程
+	_exit(0);
+}
@@ -0,0 +1,121 @@
+//PendingTable: 与std::map对照的随机插入/取出/删除, 后移删除后查找不中断, 扩容后保持内容
+#include <map>
+#include <random>
+#include "core/pending_table.h"
+#include "check.h"
+
+using namespace net;
+
+namespace
+{
+class TestFuture : public IFuture
+{
+public:
+	virtual long tick() {return 0;}
+protected:
+	virtual void done() {}
+};
+
+void checkSame(PendingTable& table, std::map<uint64_t, IFuturevar>& expect)
+{
+	CHECK(table.size() == expect.size());
+	size_t n = 0;
+	for(size_t i = 0; i < table.capacity(); i++)
+	{
+		if(table.at(i))
+			n++;
+	}
+	CHECK(n == expect.size());
+}
+
+//随机操作, 小键空间使探测链足够长
+void randomOps(const uint64_t keys, const int ops, const unsigned seed)
+{
+	std::mt19937_64 rng(seed);
+	PendingTable table;
+	std::map<uint64_t, IFuturevar> expect;
+	for(int n = 0; n < ops; n++)
+	{
+		const uint64_t sn = rng() % keys;
+		const int op = (int)(rng() % 3);
+		std::map<uint64_t, IFuturevar>::iterator it = expect.find(sn);
+		if(op == 0)
+		{
+			IFuturevar future(new TestFuture());
+			IFuturevar old;
+			CHECK(table.insert(sn, future.ptr(), old) == (it != expect.end()));
+			if(it != expect.end())
+				CHECK(old.ptr() == it->second.ptr());
+			expect[sn] = future;
+		}
+		else if(op == 1)
+		{
+			IFuturevar future;
+			CHECK(table.take(sn, future) == (it != expect.end()));
+			if(it != expect.end())
+			{
+				CHECK(future.ptr() == it->second.ptr());
+				expect.erase(it);
+			}
+		}
+		else
+		{
+			CHECK(table.erase(sn) == (it != expect.end()));
+			if(it != expect.end())
+				expect.erase(it);
+		}
+		CHECK(table.size() == expect.size());
+	}
+	checkSame(table, expect);
+
+	//剩下的都还能取到
+	for(std::map<uint64_t, IFuturevar>::iterator it = expect.begin(); it != expect.end(); ++it)
+	{
+		IFuturevar future;
+		IFuturevar old;
+		CHECK(table.take(it->first, future));
+		CHECK(future.ptr() == it->second.ptr());
+		CHECK(!table.insert(it->first, future.ptr(), old));
+	}
+	std::vector<IFuturevar> all;
+	table.takeAll(all);
+	CHECK(all.size() == expect.size());
+	CHECK(table.empty());
+}
+}
+
+int main()
+{
+	randomOps(64, 100000, 1);
+	randomOps(3000, 200000, 2);
+	randomOps(1ULL << 40, 100000, 3);
+
+	//连续序号: 扩容和按顺序取出
+	PendingTable table;
+	std::vector<IFuturevar> futures;
+	for(uint64_t sn = 1; sn <= 100000; sn++)
+	{
+		IFuturevar old;
+		futures.push_back(IFuturevar(new TestFuture()));
+		CHECK(!table.insert(sn, futures.back().ptr(), old));
+	}
+	CHECK(table.size() == 100000);
+	CHECK(table.capacity() >= 200000);
+	for(uint64_t sn = 1; sn <= 100000; sn += 2)
+	{
+		IFuturevar future;
+		CHECK(table.take(sn, future));
+		CHECK(future.ptr() == futures[sn - 1].ptr());
+	}
+	for(uint64_t sn = 2; sn <= 100000; sn += 2)
+	{
+		CHECK(table.erase(sn));
+		CHECK(!table.erase(sn));
+	}
+	CHECK(table.empty());
+	IFuturevar missing;
+	CHECK(!table.take(1, missing));
+
+	printf("ok\n");
+	return 0;
+}
@@ -0,0 +1,41 @@
+//Scheduler路由: 连接ID回到所属线程, 普通hashkey(包括最高位为1的)只在子线程间取模
+#include <random>
+#include "core/common.h"
+#include "check.h"
+
+using namespace net;
+
+int main()
+{
+	std::mt19937 rng(7);
+	for(uint32_t workers = 1; workers <= CONNID_OWNER_MASK; workers++)
+	{
+		for(uint32_t owner = 0; owner < workers; owner++)
+		{
+			CHECK(routeConnId(makeConnId(owner, 1), workers) == owner);
+			CHECK(routeConnId(makeConnId(owner, CONNID_SEQ_MASK), workers) == owner);
+			CHECK(routeConnId(makeConnId(owner, rng()), workers) == owner);
+		}
+		if(workers < 2)
+			continue;
+		//普通hashkey不到主线程, 即使看起来像连接ID
+		for(uint32_t owner = 0; owner < workers; owner++)
+		{
+			const uint32_t key = makeConnId(owner, rng());
+			CHECK(routeHashKey(key, workers) == key % (workers-1) + 1);
+		}
+		for(int i = 0; i < 1000; i++)
+		{
+			const uint32_t key = rng();
+			const uint32_t index = routeHashKey(key, workers);
+			CHECK(index != 0 && index < workers);
+		}
+		CHECK(routeHashKey(0, workers) == 1);
+		CHECK(routeHashKey(0xFFFFFFFF, workers) != 0);
+		//所属线程不存在的连接ID按普通hashkey处理
+		const uint32_t stale = makeConnId(workers, 1);
+		CHECK(routeConnId(stale, workers) == routeHashKey(stale, workers));
+	}
+	printf("ok\n");
+	return 0;
+}
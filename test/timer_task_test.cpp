@@ -0,0 +1,71 @@
+//TimerTask: 退出过程中取消/释放句柄投递失败时, 任务不能在非所属线程删除, 取消后不再执行
+#include <unistd.h>
+#include <atomic>
+#include "core/scheduler.h"
+#include "check.h"
+
+using namespace net;
+
+namespace
+{
+std::atomic<int> fired(0);
+
+void onTimer(const int& v)
+{
+	fired.fetch_add(1);
+}
+
+bool waitFired(const int n)
+{
+	for(int i = 0; i < 200 && fired.load() < n; i++)
+		usleep(5000);
+	return fired.load() >= n;
+}
+}
+
+int main()
+{
+	Scheduler& scheduler = Scheduler::instance();
+	scheduler.start(1);
+
+	//一次性任务执行后释放最后一个句柄: 投递失败时留给所属线程, 不在这里删除
+	fired.store(0);
+	TimerHandle once = scheduler.scheduleAfter(1, 10, onTimer, 0, "once");
+	CHECK(once.valid());
+	CHECK(waitFired(1));
+	usleep(10000);
+	CHECK(!once.pending());
+	scheduler._quit = true;
+	once.reset();
+	scheduler._quit = false;
+	CHECK(Scheduler::lastError() == SCHEDULE_QUIT);
+
+	//周期任务在退出时取消: 投递失败, 定时器还挂着但不再执行
+	fired.store(0);
+	TimerHandle every = scheduler.scheduleEvery(1, 10, onTimer, 0, "every");
+	CHECK(waitFired(2));
+	scheduler._quit = true;
+	every.cancel();
+	every.reset();
+	scheduler._quit = false;
+	CHECK(Scheduler::lastError() == SCHEDULE_QUIT);
+	const int n = fired.load();
+	usleep(100000);
+	CHECK(fired.load() <= n + 1);
+
+	//正常取消
+	fired.store(0);
+	TimerHandle normal = scheduler.scheduleEvery(1, 10, onTimer, 0, "normal");
+	CHECK(waitFired(1));
+	normal.cancel();
+	usleep(20000);
+	const int m = fired.load();
+	usleep(100000);
+	CHECK(fired.load() == m);
+	CHECK(!normal.pending());
+
+	printf("ok\n");
+	fflush(stdout);
+	//IO线程不退出, 直接结束进程
+	_exit(0);
+}
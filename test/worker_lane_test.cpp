@@ -0,0 +1,114 @@
+//Worker各优先级通道的处理顺序: 已有的紧急任务优先, 之后每个普通/批量任务后最多插入一个新到的紧急任务
+//预算截断时下一轮从下一个通道开始, 紧急任务积压时普通/批量任务也有进展
+#include <unistd.h>
+#include <atomic>
+#include <vector>
+#include "core/scheduler.h"
+#include "check.h"
+
+using namespace net;
+
+namespace
+{
+const uint32_t WORKER = 1;
+
+std::atomic<bool> gateOpen(false);
+std::atomic<int> finished(0);
+std::vector<int> order;//只在IO线程写入, finished之后在主线程读取
+
+enum { TAG_URGENT = 100, TAG_NORMAL = 200, TAG_BULK = 300, TAG_SPAWN = 1000 };
+const int URGENT_BACKLOG = 40;
+
+void gate(const int& v)
+{
+	while(!gateOpen.load())
+		usleep(1000);
+}
+
+void record(const int& tag)
+{
+	order.push_back(tag);
+	finished.fetch_add(1);
+}
+
+//执行时再投递两个紧急任务
+void spawn(const int& tag)
+{
+	order.push_back(tag);
+	Scheduler::instance().scheduleTo(WORKER, record, tag + 1, "urgent", PRIORITY_URGENT);
+	Scheduler::instance().scheduleTo(WORKER, record, tag + 2, "urgent", PRIORITY_URGENT);
+	finished.fetch_add(1);
+}
+
+//|tag|类任务最早出现的位置
+size_t firstOf(const int tag)
+{
+	for(size_t i = 0; i < order.size(); i++)
+	{
+		if(order[i] / 100 * 100 == tag)
+			return i;
+	}
+	return order.size();
+}
+
+bool waitFinished(const int n)
+{
+	for(int i = 0; i < 400 && finished.load() < n; i++)
+		usleep(5000);
+	return finished.load() >= n;
+}
+
+//先阻塞IO线程, 让之后的任务在同一轮开始时已经排队
+void block()
+{
+	gateOpen.store(false);
+	finished.store(0);
+	order.clear();
+	CHECK(Scheduler::instance().scheduleTo(WORKER, gate, 0, "gate"));
+	usleep(20000);
+}
+}
+
+int main()
+{
+	Scheduler& scheduler = Scheduler::instance();
+	scheduler.start(1);
+	for(int i = 0; i < 200 && !scheduler.getWorker(WORKER)->getThreadId(); i++)
+		usleep(5000);
+
+	//普通任务执行中新到的两个紧急任务: 只有一个插在下一个普通任务之前
+	block();
+	CHECK(scheduler.scheduleTo(WORKER, record, (int)TAG_URGENT, "urgent", PRIORITY_URGENT));
+	CHECK(scheduler.scheduleTo(WORKER, spawn, (int)TAG_SPAWN, "spawn"));
+	CHECK(scheduler.scheduleTo(WORKER, record, (int)TAG_NORMAL, "normal"));
+	CHECK(scheduler.scheduleTo(WORKER, record, (int)TAG_NORMAL + 1, "normal"));
+	gateOpen.store(true);
+	CHECK(waitFinished(6));
+
+	const int expected[] = {TAG_URGENT, TAG_SPAWN, TAG_SPAWN + 1, TAG_NORMAL, TAG_SPAWN + 2, TAG_NORMAL + 1};
+	CHECK(order.size() == sizeof(expected) / sizeof(expected[0]));
+	for(size_t i = 0; i < order.size(); i++)
+	{
+		if(order[i] != expected[i])
+			fprintf(stderr, "order[%zu] = %d, expected %d\n", i, order[i], expected[i]);
+		CHECK(order[i] == expected[i]);
+	}
+
+	//每轮最多4个任务, 紧急任务积压远超预算: 普通/批量任务不必等紧急任务全部处理完
+	scheduler.getWorker(WORKER)->setBudget(4, 0);
+	block();
+	for(int i = 0; i < URGENT_BACKLOG; i++)
+		CHECK(scheduler.scheduleTo(WORKER, record, (int)TAG_URGENT + i, "urgent", PRIORITY_URGENT));
+	CHECK(scheduler.scheduleTo(WORKER, record, (int)TAG_NORMAL, "normal"));
+	CHECK(scheduler.scheduleTo(WORKER, record, (int)TAG_BULK, "bulk", PRIORITY_BULK));
+	gateOpen.store(true);
+	CHECK(waitFinished(URGENT_BACKLOG + 2));
+	CHECK(firstOf(TAG_NORMAL) < (size_t)URGENT_BACKLOG / 2);
+	CHECK(firstOf(TAG_BULK) < (size_t)URGENT_BACKLOG / 2);
+	scheduler.getWorker(WORKER)->setBudget(Worker::DEFAULT_TASK_BUDGET, Worker::DEFAULT_TIME_BUDGET);
+
+	printf("ok\n");
+	fflush(stdout);
+	//IO线程不退出, 直接结束进程
+	_exit(0);
+}
@@ -242,6 +242,23 @@ public:
 		return false;
 	}
 
+	//	数据是否在内部缓冲区(_stackbuff)中
+	inline bool inlined() const { return _data == (char*)_stackbuff; }
+	//	交出堆上的存储(调用者用delete[]释放), 之后恢复为空的内部缓冲区
+	//	数据在内部缓冲区时返回NULL, 不做任何改变
+	inline char* release()
+	{
+		if (inlined())
+			return NULL;
+		char* ptr = _data;
+		_data = (char*)_stackbuff;
+		_head = _data;
+		_tail = _data;
+		_cap = sizeof(_stackbuff);
+		_high_water_mark = 0;
+		return ptr;
+	}
+
 	//	压缩buffer空间,释放多余的内存
 	//	minCapacity [in] 保留最小的容量大小.
 	//	(当实际的cap大于minCapacity才尝试压缩)
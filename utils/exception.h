@@ -71,6 +71,7 @@ struct RpcException : public std::exception
 		CONNECTION_CLOSED = 1007,
 		WORKER_QUEUE_FULL = 1008,
 		CONNECTION_LOST = 1009,
+		CANCELLED = 1010,
 		//app user throw exception
 		APP_ERR_CODE = 2000,
 	};
@@ -123,6 +124,7 @@ struct RpcException : public std::exception
 			case TIMEOUT        		 : return "RpcException: rpc.call timeout out";
 			case CONNECTION_CLOSED       : return "RpcException: rpc.call connection closed";
 			case WORKER_QUEUE_FULL       : return "RpcException: rpc.call worker queue full";
+			case CANCELLED               : return "RpcException: rpc.call cancelled, another call completed first";
 
 			case APP_ERR_CODE 			 : return "RpcException: app throw exception no reason";
 
@@ -89,6 +89,8 @@ private:
 	Pack & operator = (const Pack& o);
 public:
 	Pack(int byteOrder = LITTLE_ENDIAN): Serializer(0,byteOrder){}
+	//直接写入外部缓冲区
+	Pack(ByteBuffer* bb, int byteOrder = LITTLE_ENDIAN): Serializer(bb,byteOrder){}
 
 	Pack(PackBuffer& p)	{}
 	virtual ~Pack() {}
@@ -0,0 +1,50 @@
+#include "varint.h"
+
+namespace lin_io
+{
+size_t Varint::write_u32(uint32_t v, uint8_t* p)
+{
+	return write_u64(v, p);
+}
+
+size_t Varint::write_u64(uint64_t v, uint8_t* p)
+{
+	size_t n = 0;
+	while (v >= 0x80)
+	{
+		p[n++] = (uint8_t)(v | 0x80);
+		v >>= 7;
+	}
+	p[n++] = (uint8_t)v;
+	return n;
+}
+
+int Varint::read(const uint8_t* p, size_t size, int64_t& value)
+{
+	uint64_t v = 0;
+	for (size_t i = 0; i < (size_t)max_varint_bytes; i++)
+	{
+		if (i >= size)
+			return 0;
+		v |= (uint64_t)(p[i] & 0x7F) << (7 * i);
+		if (!(p[i] & 0x80))
+		{
+			value = unzigzag(v);
+			return (int)(i + 1);
+		}
+	}
+	return -1;
+}
+
+size_t Varint::size(int64_t v)
+{
+	uint64_t u = zigzag(v);
+	size_t n = 1;
+	while (u >= 0x80)
+	{
+		u >>= 7;
+		n++;
+	}
+	return n;
+}
+}
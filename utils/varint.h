@@ -0,0 +1,42 @@
+/*
+ *	@file		varint.h
+ *	@intro		google protocol buffer风格的varint编码
+ *				. 每字节低7位为数据, 最高位为1表示后面还有字节
+ *				. 有符号数先做zigzag编码, 绝对值小的负数也只占很少字节
+ */
+
+#ifndef __NIO_VARINT_H__
+#define __NIO_VARINT_H__
+
+#include "int_types.h"
+#include <stddef.h>
+
+namespace lin_io
+{
+inline uint32_t zigzag32(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+inline uint64_t zigzag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+inline int64_t unzigzag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+struct Varint
+{
+	enum
+	{
+		max_varint_bytes = 10,
+	};
+
+	//	写入|p|, 返回写入的字节数, |p|至少要有max_varint_bytes可写
+	static size_t write_u32(uint32_t v, uint8_t* p);
+	static size_t write_u64(uint64_t v, uint8_t* p);
+
+	//	读出一个varint(zigzag解码后的值)
+	//	>0 : 读取的字节数
+	//	0  : 数据不完整
+	//	-1 : 超过max_varint_bytes, 格式错误
+	static int read(const uint8_t* p, size_t size, int64_t& value);
+
+	//	zigzag编码后写入需要的字节数
+	static size_t size(int64_t v);
+};
+}
+
+#endif